@@ -0,0 +1,115 @@
+#ifndef ALLOCATION_TRACKER_H
+#define ALLOCATION_TRACKER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+#include <new>
+
+namespace ParticleLife
+{
+    // Process-wide count of heap allocations, to check that a warm frame does
+    // not allocate at all. Three sources feed it: blocks the BlockPool takes
+    // from the heap (always), the global operator new (once a program installs
+    // the hooks below) and ImGui (once its allocator functions point here).
+    // Frees are not counted; a frame that allocates and frees is still a frame
+    // that allocated.
+    //
+    // To install the operator new hooks, define PARTICLE_LIFE_ALLOCATION_HOOKS
+    // before including this header in exactly one translation unit.
+    class AllocationTracker
+    {
+    public:
+        struct Counts
+        {
+            std::size_t allocations;
+            std::size_t bytes;
+        };
+
+        static AllocationTracker& instance()
+        {
+            static AllocationTracker tracker;
+            return tracker;
+        }
+
+        void record(std::size_t bytes)
+        {
+            allocations.fetch_add(1, std::memory_order_relaxed);
+            total_bytes.fetch_add(bytes, std::memory_order_relaxed);
+        }
+
+        // Totals so far; a frame's are the difference of two of these.
+        Counts counts() const { return { allocations.load(std::memory_order_relaxed), total_bytes.load(std::memory_order_relaxed) }; }
+
+        Counts since(const Counts& start) const
+        {
+            const Counts now = counts();
+            return { now.allocations - start.allocations, now.bytes - start.bytes };
+        }
+
+        // For ImGui::SetAllocatorFunctions(), which has to come before ImGui::CreateContext().
+        static void* imguiAlloc(std::size_t bytes, void*)
+        {
+            instance().record(bytes);
+            return malloc(bytes);
+        }
+
+        static void imguiFree(void* block, void*) { free(block); }
+
+    private:
+        std::atomic<std::size_t> allocations{ 0 };
+        std::atomic<std::size_t> total_bytes{ 0 };
+    };
+}
+
+#if defined(PARTICLE_LIFE_ALLOCATION_HOOKS)
+// Replaces the throwing forms of operator new and delete; the array and nothrow
+// forms are defined in terms of these, so they are counted too. GCC takes the
+// free() of a pointer that came from operator new for a mismatch once inlined.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void* operator new(std::size_t bytes)
+{
+    ParticleLife::AllocationTracker::instance().record(bytes);
+    if (void* block = malloc(bytes > 0 ? bytes : 1))
+        return block;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t bytes, std::align_val_t alignment)
+{
+    ParticleLife::AllocationTracker::instance().record(bytes);
+    const std::size_t align = static_cast<std::size_t>(alignment);
+#if defined(_MSC_VER)
+    void* block = _aligned_malloc(bytes > 0 ? bytes : 1, align);
+#else
+    // aligned_alloc() wants a whole number of alignments.
+    const std::size_t rounded = (bytes + align - 1) & ~(align - 1);
+    void* block = aligned_alloc(align, rounded > 0 ? rounded : align);
+#endif
+    if (block)
+        return block;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* block) noexcept { free(block); }
+void operator delete(void* block, std::size_t) noexcept { free(block); }
+
+#if defined(_MSC_VER)
+void operator delete(void* block, std::align_val_t) noexcept { _aligned_free(block); }
+void operator delete(void* block, std::size_t, std::align_val_t) noexcept { _aligned_free(block); }
+#else
+void operator delete(void* block, std::align_val_t) noexcept { free(block); }
+void operator delete(void* block, std::size_t, std::align_val_t) noexcept { free(block); }
+#endif
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif // PARTICLE_LIFE_ALLOCATION_HOOKS
+
+#endif // ALLOCATION_TRACKER_H
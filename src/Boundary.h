@@ -0,0 +1,80 @@
+#ifndef BOUNDARY_H
+#define BOUNDARY_H
+
+#include <math.h>
+#include "ParticleObject.h"
+#include "ParticleLife.h"
+
+namespace ParticleLife
+{
+    // Boundary policies for the buffered kernels. A kernel asks for the
+    // displacement between two particles through minimumImage(), for the periodic
+    // copies of the world to search through imageX()/imageY() (Images per axis),
+    // and moves particles with integrate().
+
+    // No wrapping: velocities reflect at the walls as in rule(), or nothing at all
+    // happens at the edges of an open world.
+    struct Walls
+    {
+        static const int Images = 1;
+
+        WorldBounds world;
+
+        explicit Walls(const WorldBounds& bounds) : world(bounds) {}
+
+        float imageX(int) const { return 0.0f; }
+        float imageY(int) const { return 0.0f; }
+        void minimumImage(float&, float&) const {}
+        void integrate(ParticleObject& a, float fx, float fy, const TimeStep& time) const { ParticleLife::integrate(a, fx, fy, world, time); }
+    };
+
+    // Wrap-around world: positions live in [0, width) x [0, height) and every pair
+    // interacts through its nearest image. Interaction radii are capped at
+    // maxRadius() so that at most one image of a particle is ever in range.
+    struct Torus
+    {
+        static const int Images = 3;
+
+        float width;
+        float height;
+
+        explicit Torus(const WorldBounds& world) : width(world.width), height(world.height) {}
+
+        float maxRadius() const { return 0.5f * (width < height ? width : height); }
+
+        // Images -1, 0, +1 along each axis.
+        float imageX(int k) const { return (k - 1) * width; }
+        float imageY(int k) const { return (k - 1) * height; }
+
+        // Takes off the nearest whole number of periods. Adding and removing
+        // 1.5 * 2^23 rounds to the nearest integer in plain float arithmetic,
+        // with no branch (which would mispredict at every seam crossing) and no
+        // int conversion in the pair loop.
+        void minimumImage(float& dx, float& dy) const
+        {
+            const float round = 12582912.0f;
+            dx -= width * ((dx * (1.0f / width) + round) - round);
+            dy -= height * ((dy * (1.0f / height) + round) - round);
+        }
+
+        void wrap(ParticleObject& a) const
+        {
+            a.x -= width * floorf(a.x / width);
+            a.y -= height * floorf(a.y / height);
+            // A tiny negative coordinate rounds up to exactly the extent.
+            if (a.x >= width) a.x -= width;
+            if (a.y >= height) a.y -= height;
+        }
+
+        void integrate(ParticleObject& a, float fx, float fy, const TimeStep& time) const
+        {
+            a.vx = (a.vx + fx * time.dt) * time.retain;
+            a.vy = (a.vy + fy * time.dt) * time.retain;
+            a.x += a.vx * time.dt;
+            a.y += a.vy * time.dt;
+            wrap(a);
+        }
+    };
+}
+
+#endif // BOUNDARY_H
@@ -0,0 +1,185 @@
+#ifndef CANVAS_H
+#define CANVAS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include <math.h>
+#include "imgui.h"
+#include "ParticleLife.h"
+#include "SpatialGrid.h"
+
+namespace ParticleLife
+{
+    // Maps world coordinates to canvas pixels: screen = (world - (x, y)) * zoom.
+    struct Camera
+    {
+        float x = 0.0f;
+        float y = 0.0f;
+        float zoom = 1.0f;      // pixels per world unit
+
+        float screenX(float wx) const { return (wx - x) * zoom; }
+        float screenY(float wy) const { return (wy - y) * zoom; }
+        float worldX(float sx) const { return x + sx / zoom; }
+        float worldY(float sy) const { return y + sy / zoom; }
+
+        // Whole world in view, centred. The default world on the default canvas is 1:1.
+        void fit(const WorldBounds& world, float width, float height)
+        {
+            zoom = std::min(width / world.width, height / world.height);
+            x = 0.5f * (world.width - width / zoom);
+            y = 0.5f * (world.height - height / zoom);
+        }
+
+        void pan(float dx, float dy)
+        {
+            x -= dx / zoom;
+            y -= dy / zoom;
+        }
+
+        // Keeps the world point under (sx, sy) in place.
+        void zoomAt(float sx, float sy, float factor)
+        {
+            const float wx = worldX(sx);
+            const float wy = worldY(sy);
+            zoom *= factor;
+            x = wx - sx / zoom;
+            y = wy - sy / zoom;
+        }
+    };
+
+    // Draws what a Camera sees. Only the grid cells overlapping the view are
+    // visited, and below lod_zoom the particles are binned into screen tiles and
+    // drawn as a density map, one rectangle per occupied tile instead of one
+    // circle per particle.
+    class CanvasRenderer
+    {
+    public:
+        float lod_zoom = 0.25f;     // density map below this many pixels per world unit
+        int tile = 4;               // density map tile, pixels
+        float cell_size = 64.0f;    // own culling grid, when the solver has none
+
+        // Stats of the last draw().
+        std::size_t drawn = 0;      // circles or tiles emitted
+        std::size_t visited = 0;    // particles looked at
+        bool density = false;
+
+        // grid may be the solver's, as long as it was updated against these groups
+        // since they last changed size; its entries can lag the particles by a
+        // step, which the extra cell of margin around the view absorbs.
+        void draw(ImDrawList* draw_list, ImVec2 origin, ImVec2 size, const Camera& camera, const WorldBounds& world, const ParticleGroups& groups, const UniformGrid* grid = nullptr)
+        {
+            drawn = 0;
+            visited = 0;
+            density = camera.zoom < lod_zoom;
+
+            const float x0 = camera.worldX(0.0f), x1 = camera.worldX(size.x);
+            const float y0 = camera.worldY(0.0f), y1 = camera.worldY(size.y);
+
+            if (density)
+            {
+                tiles_x = static_cast<int>(size.x) / tile + 1;
+                tiles_y = static_cast<int>(size.y) / tile + 1;
+                tiles.assign(tiles_x * tiles_y, Tile());
+            }
+
+            // Particles grow when zoomed in but never shrink below their 1:1 size.
+            const float radius = 1.8f * std::max(1.0f, camera.zoom);
+            const auto emit = [&](const ParticleObject& p)
+            {
+                ++visited;
+                if (p.x < x0 || p.x > x1 || p.y < y0 || p.y > y1)
+                    return;
+
+                const float sx = camera.screenX(p.x);
+                const float sy = camera.screenY(p.y);
+                if (!density)
+                {
+                    draw_list->AddCircleFilled(ImVec2(origin.x + sx, origin.y + sy), radius, p.color);
+                    ++drawn;
+                    return;
+                }
+
+                Tile& t = tiles[static_cast<int>(sy) / tile * tiles_x + static_cast<int>(sx) / tile];
+                t.r += (p.color >> IM_COL32_R_SHIFT) & 0xFF;
+                t.g += (p.color >> IM_COL32_G_SHIFT) & 0xFF;
+                t.b += (p.color >> IM_COL32_B_SHIFT) & 0xFF;
+                ++t.count;
+            };
+
+            // Nothing to cull when the whole world is in view.
+            const bool everything = x0 <= 0.0f && y0 <= 0.0f && x1 >= world.width && y1 >= world.height;
+            if (everything && !grid)
+            {
+                for (const auto& group : groups)
+                    for (const auto& p : group)
+                        emit(p);
+            }
+            else
+            {
+                // The solver's entries may lag by a step, hence a cell of margin.
+                const float margin = grid ? grid->size : 0.0f;
+                if (!grid)
+                {
+                    // Over the view only, with cells widened so that a far zoomed
+                    // out view still gets at most MaxCells of them. Everything
+                    // outside clamps into the border cells, which are skipped.
+                    const float w = x1 - x0 + 2.0f * cell_size, h = y1 - y0 + 2.0f * cell_size;
+                    const float cell = std::max(cell_size, sqrtf(w * h / MaxCells));
+                    own_grid.buildWithin(groups, cell, x0 - cell, y0 - cell, x1 + cell, y1 + cell);
+                    grid = &own_grid;
+                }
+
+                const int cx0 = grid->cellX(x0 - margin), cx1 = grid->cellX(x1 + margin);
+                const int cy0 = grid->cellY(y0 - margin), cy1 = grid->cellY(y1 + margin);
+                for (int cy = cy0; cy <= cy1; ++cy)
+                {
+                    const GridEntry* e = grid->cellBegin(grid->cellIndex(cx0, cy));
+                    const GridEntry* end = grid->cellEnd(grid->cellIndex(cx1, cy));
+                    for (; e != end; ++e)
+                        if (e->index >= 0)
+                            emit(groups[e->group][e->index]);
+                }
+            }
+
+            if (density)
+                drawTiles(draw_list, origin);
+        }
+
+    private:
+        static constexpr float MaxCells = 65536.0f;
+
+        struct Tile
+        {
+            unsigned int r = 0, g = 0, b = 0;
+            unsigned int count = 0;
+        };
+
+        // Mean colour of the tile, more opaque the more particles it holds.
+        void drawTiles(ImDrawList* draw_list, ImVec2 origin)
+        {
+            for (int ty = 0; ty < tiles_y; ++ty)
+            {
+                for (int tx = 0; tx < tiles_x; ++tx)
+                {
+                    const Tile& t = tiles[ty * tiles_x + tx];
+                    if (t.count == 0)
+                        continue;
+
+                    const unsigned int alpha = std::min(255u, 64u + 48u * t.count);
+                    const ImU32 color = IM_COL32(t.r / t.count, t.g / t.count, t.b / t.count, alpha);
+                    const ImVec2 a(origin.x + tx * tile, origin.y + ty * tile);
+                    draw_list->AddRectFilled(a, ImVec2(a.x + tile, a.y + tile), color);
+                    ++drawn;
+                }
+            }
+        }
+
+        UniformGrid own_grid;
+        std::vector<Tile> tiles;
+        int tiles_x = 0;
+        int tiles_y = 0;
+    };
+}
+
+#endif // CANVAS_H
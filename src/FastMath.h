@@ -0,0 +1,26 @@
+#ifndef FAST_MATH_H
+#define FAST_MATH_H
+
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define PARTICLE_LIFE_HAS_SSE 1
+#endif
+
+namespace ParticleLife
+{
+    // 1/sqrt(x) from the hardware estimate (~12 bits) refined with one
+    // Newton-Raphson step (~22 bits). x must be > 0.
+    inline float rsqrt(float x)
+    {
+#if defined(PARTICLE_LIFE_HAS_SSE)
+        const float y = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+        return y * (1.5f - 0.5f * x * y * y);
+#else
+        return 1.0f / std::sqrt(x);
+#endif
+    }
+}
+
+#endif // FAST_MATH_H
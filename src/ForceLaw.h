@@ -0,0 +1,103 @@
+#ifndef FORCE_LAW_H
+#define FORCE_LAW_H
+
+#include <math.h>
+#include "ForceProfile.h"
+
+namespace ParticleLife
+{
+    enum ForceLaw
+    {
+        ForceLaw_Constant,      // |F| = g: the original g / d rule
+        ForceLaw_LinearFalloff, // |F| falls linearly from g at MinDistance to 0 at radius
+        ForceLaw_LennardJones,  // g plus a capped Lennard-Jones core force, 24 epsilon (2 (sigma / d)^12 - (sigma / d)^6) / d
+        ForceLaw_COUNT
+    };
+
+    static const char* const ForceLawNames[ForceLaw_COUNT] = { "Constant (g/d)", "Linear falloff", "Lennard-Jones core" };
+
+    struct LawSettings
+    {
+        float sigma = 20.0f;    // Lennard-Jones length; the core force changes sign at 2^(1/6) sigma
+        float epsilon = 1.0f;   // Lennard-Jones strength
+    };
+
+    // Force-law policies for ruleLaw(). Each one is built per group pair, so
+    // everything that only depends on the pair is folded in the constructor and
+    // factor() is all the inner loop sees. A pair acts when min_d2 < d2 < max_d2,
+    // and factor(d2, inv_d) is F in (dx, dy) * F. The kernel passes inv_d =
+    // rsqrt(d2) so kernels that apply two laws to one pair only pay for it once.
+    struct ReferenceLaw
+    {
+        float min_d2, max_d2;
+        float g;
+
+        ReferenceLaw(float g, float radius, const LawSettings&)
+            : min_d2(MinDistance * MinDistance), max_d2(radius * radius), g(g) {}
+
+        // Exact g / d like rule(); the unused inv_d is optimised away.
+        float factor(float d2, float) const { return g / sqrtf(d2); }
+    };
+
+    struct ConstantLaw
+    {
+        float min_d2, max_d2;
+        float g;
+
+        ConstantLaw(float g, float radius, const LawSettings&)
+            : min_d2(MinDistance * MinDistance), max_d2(radius * radius), g(g) {}
+
+        float factor(float, float inv_d) const { return g * inv_d; }
+    };
+
+    struct LinearFalloffLaw
+    {
+        float min_d2, max_d2;
+        float radius;
+        float k;
+
+        LinearFalloffLaw(float g, float radius, const LawSettings&)
+            : min_d2(MinDistance * MinDistance), max_d2(radius * radius), radius(radius), k(g / (radius - MinDistance)) {}
+
+        // g * (radius - d) / (radius - MinDistance) / d
+        float factor(float, float inv_d) const { return k * (radius * inv_d - 1.0f); }
+    };
+
+    struct LennardJonesLaw
+    {
+        // Keeps the core from launching particles that start almost on top of each other.
+        static constexpr float MaxRepulsion = 2.0f;
+
+        float min_d2, max_d2;
+        float g;
+        float sigma2;
+        float epsilon;
+
+        LennardJonesLaw(float g, float radius, const LawSettings& settings)
+            : min_d2(1.0f), max_d2(radius * radius), g(g), sigma2(settings.sigma * settings.sigma), epsilon(settings.epsilon) {}
+
+        float factor(float, float inv_d) const
+        {
+            const float s2 = sigma2 * inv_d * inv_d;
+            const float s6 = s2 * s2 * s2;
+            // -dV/dd of V = 4 epsilon (s^12 - s^6), positive pushing apart.
+            const float core = 24.0f * epsilon * s6 * (2.0f * s6 - 1.0f) * inv_d;
+            const float magnitude = fminf(g + core, MaxRepulsion);
+            return magnitude * inv_d;
+        }
+    };
+
+    // Reads the magnitude from a ForceTable, see ForceProfile.h.
+    struct TableLaw
+    {
+        float min_d2, max_d2;
+        const ForceTable& table;
+
+        explicit TableLaw(const ForceTable& table)
+            : min_d2(table.min_d2), max_d2(table.max_d2), table(table) {}
+
+        float factor(float d2, float inv_d) const { return table.lookup(d2) * inv_d; }
+    };
+}
+
+#endif // FORCE_LAW_H
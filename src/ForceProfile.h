@@ -0,0 +1,80 @@
+#ifndef FORCE_PROFILE_H
+#define FORCE_PROFILE_H
+
+#include <math.h>
+
+namespace ParticleLife
+{
+    // Below this distance the original rule() ignores a pair entirely.
+    const float MinDistance = 12.0f;
+
+    enum ForceShape
+    {
+        ForceShape_Constant,    // |F| = g inside (MinDistance, radius): the original g / d rule
+        ForceShape_LinearRamp,  // |F| falls linearly from g at MinDistance to 0 at radius
+        ForceShape_SoftCore,    // bounded repulsive core out to core * radius, then a tent of height g
+        ForceShape_COUNT
+    };
+
+    static const char* const ForceShapeNames[ForceShape_COUNT] = { "Constant (g/d)", "Linear ramp", "Soft core" };
+
+    // Force magnitude at distance d. Positive pushes particles apart, the same sign
+    // convention as g in rule(). Cutoffs are not applied here, see ForceTable.
+    inline float forceMagnitude(ForceShape shape, float g, float d, float radius, float core)
+    {
+        switch (shape)
+        {
+        case ForceShape_LinearRamp:
+            return g * (radius - d) / (radius - MinDistance);
+        case ForceShape_SoftCore:
+        {
+            const float r_core = core * radius;
+            if (d < r_core)
+                return 1.0f - d / r_core;
+            const float t = (d - r_core) / (radius - r_core);
+            return g * (1.0f - fabsf(2.0f * t - 1.0f));
+        }
+        case ForceShape_Constant:
+        default:
+            return g;
+        }
+    }
+
+    // A pair's force magnitude sampled uniformly in squared distance over
+    // [min_d2, max_d2], so kernels can look it up without a sqrt. The magnitude is
+    // tabulated rather than |F| / d because it stays bounded and smooth near the
+    // core, where 1 / d would need far more samples; kernels scale by rsqrt(d2).
+    struct ForceTable
+    {
+        static const int Samples = 256;
+
+        float min_d2;
+        float max_d2;
+        float scale;                    // samples per unit of squared distance
+        float values[Samples + 2];      // one extra so lookup(max_d2) can read i + 1
+
+        void build(ForceShape shape, float g, float radius, float core)
+        {
+            // The soft core acts at short range and only skips coincident particles.
+            const float min_d = shape == ForceShape_SoftCore ? 1.0f : MinDistance;
+            min_d2 = min_d * min_d;
+            max_d2 = radius * radius;
+            scale = Samples / (max_d2 - min_d2);
+
+            for (int i = 0; i <= Samples; ++i)
+                values[i] = forceMagnitude(shape, g, sqrtf(min_d2 + i / scale), radius, core);
+            values[Samples + 1] = values[Samples];
+        }
+
+        // Only valid for min_d2 <= d2 <= max_d2.
+        float lookup(float d2) const
+        {
+            const float x = (d2 - min_d2) * scale;
+            const int i = static_cast<int>(x);
+            const float t = x - i;
+            return values[i] + t * (values[i + 1] - values[i]);
+        }
+    };
+}
+
+#endif // FORCE_PROFILE_H
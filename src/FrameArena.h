@@ -0,0 +1,144 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include "PoolAllocator.h"
+
+namespace ParticleLife
+{
+    // Bump allocator for scratch that lives no longer than one step: law
+    // matrices, per-thread partial results, traversal stacks. Allocation is a
+    // pointer increment and nothing is freed on its own; a Scope hands back
+    // everything allocated inside it when it closes, and reset() ends the step.
+    //
+    // Each thread has its own arena and only the thread that steps allocates, so
+    // none of this is locked. A step that outgrows the block takes another one
+    // from the BlockPool; the next reset() merges them into one block of the
+    // high-water mark, after which the same step runs without touching the heap.
+    class FrameArena
+    {
+    public:
+        static FrameArena& instance()
+        {
+            static thread_local FrameArena arena;
+            return arena;
+        }
+
+        // Gives back everything allocated from the arena since it opened.
+        class Scope
+        {
+        public:
+            Scope() : arena(instance()), chunk(arena.chunk), used(arena.used) {}
+            ~Scope()
+            {
+                arena.chunk = chunk;
+                arena.used = used;
+            }
+
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+
+        private:
+            FrameArena& arena;
+            std::size_t chunk;
+            std::size_t used;
+        };
+
+        ~FrameArena()
+        {
+            for (const Chunk& c : chunks)
+                BlockPool::instance().deallocate(c.data, c.size);
+        }
+
+        // 64-byte aligned, so per-thread slots do not share cache lines.
+        void* allocate(std::size_t bytes)
+        {
+            bytes = (bytes + BlockPool::Alignment - 1) & ~(BlockPool::Alignment - 1);
+            while (chunk < chunks.size() && used + bytes > chunks[chunk].size)
+            {
+                ++chunk;
+                used = 0;
+            }
+            if (chunk == chunks.size())
+                grow(bytes);
+
+            char* block = chunks[chunk].data + used;
+            used += bytes;
+            high_water = std::max(high_water, offset());
+            return block;
+        }
+
+        // n default-initialised Ts; they are never destroyed.
+        template <typename T>
+        T* allocate(std::size_t n)
+        {
+            static_assert(std::is_trivially_destructible<T>::value, "arena memory is released without running destructors");
+            T* data = static_cast<T*>(allocate(n * sizeof(T)));
+            for (std::size_t i = 0; i < n; ++i)
+                ::new (static_cast<void*>(data + i)) T;
+            return data;
+        }
+
+        // Ends a step: releases everything and, if the step needed more than one
+        // block, replaces them with one that holds the high-water mark.
+        void reset()
+        {
+            chunk = 0;
+            used = 0;
+            if (chunks.size() > 1)
+            {
+                for (const Chunk& c : chunks)
+                    BlockPool::instance().deallocate(c.data, c.size);
+                chunks.clear();
+                grow(high_water);
+                chunk = 0;
+            }
+        }
+
+        std::size_t capacity() const
+        {
+            std::size_t bytes = 0;
+            for (const Chunk& c : chunks)
+                bytes += c.size;
+            return bytes;
+        }
+
+        std::size_t high_water = 0;             // most bytes live at once, over all steps
+        std::size_t heap_allocations = 0;       // blocks taken for the arena, ever
+
+    private:
+        struct Chunk
+        {
+            char* data;
+            std::size_t size;
+        };
+
+        static const std::size_t MinChunk = 64 * 1024;
+
+        // Bytes in use, counting earlier chunks as full.
+        std::size_t offset() const
+        {
+            std::size_t bytes = used;
+            for (std::size_t c = 0; c < chunk; ++c)
+                bytes += chunks[c].size;
+            return bytes;
+        }
+
+        void grow(std::size_t bytes)
+        {
+            const std::size_t size = bytes > MinChunk ? bytes : MinChunk;
+            chunks.push_back({ static_cast<char*>(BlockPool::instance().allocate(size)), size });
+            ++heap_allocations;
+        }
+
+        std::vector<Chunk> chunks;
+        std::size_t chunk = 0;          // the one being bumped; later ones are spare
+        std::size_t used = 0;           // bytes used in it
+    };
+}
+
+#endif // FRAME_ARENA_H
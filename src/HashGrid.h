@@ -0,0 +1,182 @@
+#ifndef HASH_GRID_H
+#define HASH_GRID_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <math.h>
+#include "ParticleLife.h"
+#include "SpatialGrid.h"
+
+namespace ParticleLife
+{
+    // Sparse cell list: only occupied cells exist, found through an open
+    // addressing table keyed on the cell coordinates, so memory follows the
+    // particles rather than the world's extent and coordinates may be anything.
+    // As in UniformGrid the entries of one cell are contiguous; cells are
+    // numbered in the order they were first seen.
+    class HashGrid
+    {
+    public:
+        void build(const ParticleGroups& groups, float cell_size)
+        {
+            size = cell_size;
+            inv_size = 1.0f / cell_size;
+
+            // At most one cell per particle; the table starts from last time's
+            // occupancy and grows while inserting.
+            std::size_t total = 0;
+            for (const auto& group : groups)
+                total += group.size();
+            resetTable(cell_xs.size() * 4);
+            cell_xs.clear();
+            cell_ys.clear();
+            cell_start.assign(1, 0);
+            cell_of.resize(total);
+
+            std::size_t k = 0;
+            for (const auto& group : groups)
+            {
+                for (const auto& p : group)
+                {
+                    const int cell = insert(cellCoordinate(p.x), cellCoordinate(p.y));
+                    cell_of[k++] = cell;
+                    ++cell_start[cell + 1];
+                }
+            }
+            for (std::size_t c = 0; c < cell_xs.size(); ++c)
+                cell_start[c + 1] += cell_start[c];
+
+            entries.resize(total);
+            reserveGrowing(fill, cell_start.size() - 1);
+            fill.assign(cell_start.begin(), cell_start.end() - 1);
+            k = 0;
+            for (int g = 0; g < GroupCount; ++g)
+            {
+                for (std::size_t i = 0; i < groups[g].size(); ++i, ++k)
+                {
+                    const auto& p = groups[g][i];
+                    entries[fill[cell_of[k]]++] = { p.x, p.y, g, static_cast<int>(i) };
+                }
+            }
+        }
+
+        // Occupied cells only.
+        int cellCount() const { return static_cast<int>(cell_xs.size()); }
+
+        // Cell along one axis. Clamped in float before the conversion, well inside
+        // int so that neighbour offsets cannot overflow either; only positions an
+        // open world's escaped particles reach are affected.
+        int cellCoordinate(float v) const
+        {
+            const float limit = 1073741824.0f;   // 2^30
+            return static_cast<int>(std::min(std::max(-limit, floorf(v * inv_size)), limit));
+        }
+        int cellX(int cell) const { return cell_xs[cell]; }
+        int cellY(int cell) const { return cell_ys[cell]; }
+
+        // Cell at (cx, cy), or -1 if it holds no particle.
+        int find(int cx, int cy) const
+        {
+            const std::uint64_t key = pack(cx, cy);
+            for (std::size_t slot = hash(key);; slot = (slot + 1) & mask)
+            {
+                if (table[slot].cell < 0)
+                    return -1;
+                if (table[slot].key == key)
+                    return table[slot].cell;
+            }
+        }
+
+        int reach(float radius) const { return static_cast<int>(ceilf(radius * inv_size)); }
+
+        const GridEntry* cellBegin(int cell) const { return entries.data() + cell_start[cell]; }
+        const GridEntry* cellEnd(int cell) const { return entries.data() + cell_start[cell + 1]; }
+
+        // Table slots, for comparing memory against a dense grid.
+        std::size_t capacity() const { return table.size(); }
+
+        float size = 1.0f;
+        float inv_size = 1.0f;
+
+    private:
+        struct Slot
+        {
+            std::uint64_t key;
+            int cell;       // -1 for an empty slot
+        };
+
+        static std::uint64_t pack(int cx, int cy)
+        {
+            return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(cx)) << 32) | static_cast<std::uint32_t>(cy);
+        }
+
+        // Fibonacci hashing: the top bits of key * 2^64 / phi.
+        std::size_t hash(std::uint64_t key) const
+        {
+            return static_cast<std::size_t>((key * 0x9E3779B97F4A7C15ull) >> shift);
+        }
+
+        void resetTable(std::size_t min_slots)
+        {
+            std::size_t slots = 64;
+            shift = 58;
+            while (slots < min_slots)
+            {
+                slots *= 2;
+                --shift;
+            }
+            mask = slots - 1;
+            table.assign(slots, Slot{ 0, -1 });
+        }
+
+        // Returns the cell at (cx, cy), adding it if new. Keeps the load below one
+        // half so probe runs stay short.
+        int insert(int cx, int cy)
+        {
+            const std::uint64_t key = pack(cx, cy);
+            std::size_t slot = hash(key);
+            for (; table[slot].cell >= 0; slot = (slot + 1) & mask)
+                if (table[slot].key == key)
+                    return table[slot].cell;
+
+            const int cell = static_cast<int>(cell_xs.size());
+            table[slot] = { key, cell };
+            cell_xs.push_back(cx);
+            cell_ys.push_back(cy);
+            cell_start.push_back(0);
+
+            if (cell_xs.size() * 2 > table.size())
+                rehash();
+            return cell;
+        }
+
+        void rehash()
+        {
+            resetTable(table.size() * 2);
+            for (std::size_t c = 0; c < cell_xs.size(); ++c)
+            {
+                const std::uint64_t key = pack(cell_xs[c], cell_ys[c]);
+                std::size_t slot = hash(key);
+                while (table[slot].cell >= 0)
+                    slot = (slot + 1) & mask;
+                table[slot] = { key, static_cast<int>(c) };
+            }
+        }
+
+        std::vector<Slot> table;
+        std::size_t mask = 0;
+        int shift = 58;
+
+        std::vector<int> cell_xs;
+        std::vector<int> cell_ys;
+        std::vector<int> cell_start;    // cellCount() + 1 prefix sums
+        std::vector<GridEntry> entries;
+
+        std::vector<int> cell_of;       // build scratch
+        std::vector<int> fill;          // build scratch
+    };
+}
+
+#endif // HASH_GRID_H
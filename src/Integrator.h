@@ -0,0 +1,755 @@
+#ifndef INTEGRATOR_H
+#define INTEGRATOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include <math.h>
+#include "ParticleLife.h"
+#include "Boundary.h"
+#include "FrameArena.h"
+#include "HashGrid.h"
+#include "LoadBalance.h"
+#include "ParticleStore.h"
+#include "QuadTree.h"
+#include "SpatialGrid.h"
+#include "SweepAndPrune.h"
+#include "ThreadPool.h"
+
+namespace ParticleLife
+{
+    // Two-phase stepping: every force is computed from the same positions into a
+    // ForceBuffer, then all particles are integrated once. Unlike the sequential
+    // rule() loop the result does not depend on group order. Every kernel takes
+    // a boundary policy (Walls or Torus) for the displacement between particles.
+
+    struct ForceBuffer
+    {
+        std::vector<float> fx;
+        std::vector<float> fy;
+
+        void reset(std::size_t n)
+        {
+            fx.assign(n, 0.0f);
+            fy.assign(n, 0.0f);
+        }
+    };
+
+    // Each particle gathers from every group. Rows are owned by one thread, so
+    // all threads write straight into the same buffer.
+    template <typename MakeLaw, typename Boundary>
+    inline void accumulateForces(const ParticleGroups& groups, MakeLaw make_law, const Boundary& boundary, ThreadPool& pool, ForceBuffer& forces)
+    {
+        const GroupOffsets offsets(groups);
+        forces.reset(offsets.total());
+
+        for (int i = 0; i < GroupCount; ++i)
+        {
+            const auto& group1 = groups[i];
+            pool.parallelFor(group1.size(), 64, [&](std::size_t begin, std::size_t end, int)
+            {
+                for (int j = 0; j < GroupCount; ++j)
+                {
+                    const auto law = make_law(i, j);
+                    const auto& group2 = groups[j];
+
+                    for (std::size_t a_index = begin; a_index < end; ++a_index)
+                    {
+                        const auto& a = group1[a_index];
+                        float fx = 0.0f;
+                        float fy = 0.0f;
+
+                        for (std::size_t b_index = 0; b_index < group2.size(); ++b_index)
+                        {
+                            const auto& b = group2[b_index];
+                            float dx = a.x - b.x;
+                            float dy = a.y - b.y;
+                            boundary.minimumImage(dx, dy);
+                            const float d2 = dx*dx + dy*dy;
+
+                            if (d2 > law.min_d2 && d2 < law.max_d2)
+                            {
+                                const float F = law.factor(d2, rsqrt(d2));
+                                fx += dx * F;
+                                fy += dy * F;
+                            }
+                        }
+                        forces.fx[offsets[i] + a_index] += fx;
+                        forces.fy[offsets[i] + a_index] += fy;
+                    }
+                }
+            });
+        }
+    }
+
+    // Newton's-third-law variant: each unordered pair (a, b) is visited once and the
+    // shared dx, dy, rsqrt(d2) feed both g_ab on a and g_ba on b. Writes to b can come
+    // from any row, so every thread accumulates into its own buffer and the buffers
+    // are summed into thread_forces[0] at the end.
+    //
+    // Which rows land in which thread's buffer depends on scheduling, so the sums
+    // round differently from run to run. With lanes > 0 the rows are dealt
+    // round-robin to that many buffers instead, each filled by one task in row
+    // order, and the buffers are summed in lane order: the same bits for any
+    // thread count, at the cost of lanes buffers.
+    template <typename MakeLaw, typename Boundary>
+    inline void accumulatePairForces(const ParticleGroups& groups, MakeLaw make_law, const Boundary& boundary, ThreadPool& pool, std::vector<ForceBuffer>& thread_forces, int lanes = 0)
+    {
+        const GroupOffsets offsets(groups);
+        thread_forces.resize(lanes > 0 ? lanes : pool.size());
+        for (auto& forces : thread_forces)
+            forces.reset(offsets.total());
+
+        for (int i = 0; i < GroupCount; ++i)
+        {
+            for (int j = i; j < GroupCount; ++j)
+            {
+                const auto law_ab = make_law(i, j);
+                const auto law_ba = make_law(j, i);
+                const float min_d2 = law_ab.min_d2 < law_ba.min_d2 ? law_ab.min_d2 : law_ba.min_d2;
+                const float max_d2 = law_ab.max_d2 > law_ba.max_d2 ? law_ab.max_d2 : law_ba.max_d2;
+                const auto& group1 = groups[i];
+                const auto& group2 = groups[j];
+
+                const auto row = [&](std::size_t a_index, ForceBuffer& out)
+                {
+                    float* out_bx = out.fx.data() + offsets[j];
+                    float* out_by = out.fy.data() + offsets[j];
+                    const auto& a = group1[a_index];
+                    float fx = 0.0f;
+                    float fy = 0.0f;
+
+                    for (std::size_t b_index = i == j ? a_index + 1 : 0; b_index < group2.size(); ++b_index)
+                    {
+                        const auto& b = group2[b_index];
+                        float dx = a.x - b.x;
+                        float dy = a.y - b.y;
+                        boundary.minimumImage(dx, dy);
+                        const float d2 = dx*dx + dy*dy;
+
+                        if (d2 > min_d2 && d2 < max_d2)
+                        {
+                            const float inv_d = rsqrt(d2);
+                            if (d2 > law_ab.min_d2 && d2 < law_ab.max_d2)
+                            {
+                                const float F = law_ab.factor(d2, inv_d);
+                                fx += dx * F;
+                                fy += dy * F;
+                            }
+                            if (d2 > law_ba.min_d2 && d2 < law_ba.max_d2)
+                            {
+                                const float F = law_ba.factor(d2, inv_d);
+                                out_bx[b_index] -= dx * F;
+                                out_by[b_index] -= dy * F;
+                            }
+                        }
+                    }
+                    out.fx[offsets[i] + a_index] += fx;
+                    out.fy[offsets[i] + a_index] += fy;
+                };
+
+                if (lanes > 0)
+                {
+                    // Dealing rows out round-robin also evens out the triangle (i == j).
+                    pool.parallelFor(lanes, 1, [&](std::size_t lane, std::size_t, int)
+                    {
+                        for (std::size_t a_index = lane; a_index < group1.size(); a_index += lanes)
+                            row(a_index, thread_forces[lane]);
+                    });
+                    continue;
+                }
+
+                // Rows near the top of a triangle (i == j) are longer; small chunks even that out.
+                pool.parallelFor(group1.size(), 32, [&](std::size_t begin, std::size_t end, int thread_index)
+                {
+                    for (std::size_t a_index = begin; a_index < end; ++a_index)
+                        row(a_index, thread_forces[thread_index]);
+                });
+            }
+        }
+
+        if (thread_forces.size() > 1)
+        {
+            ForceBuffer& total = thread_forces[0];
+            pool.parallelFor(offsets.total(), 1024, [&](std::size_t begin, std::size_t end, int)
+            {
+                for (std::size_t t = 1; t < thread_forces.size(); ++t)
+                {
+                    for (std::size_t k = begin; k < end; ++k)
+                    {
+                        total.fx[k] += thread_forces[t].fx[k];
+                        total.fy[k] += thread_forces[t].fy[k];
+                    }
+                }
+            });
+        }
+    }
+
+    // All GroupCount x GroupCount policies of one law, so kernels that meet several
+    // groups in one loop can pick the law by index instead of rebuilding it. The
+    // laws live in the FrameArena, until the caller's FrameArena::Scope closes.
+    template <typename Law>
+    struct LawMatrix
+    {
+        Law* laws;
+
+        const Law* row(int i) const { return laws + i * GroupCount; }
+    };
+
+    template <typename MakeLaw>
+    inline auto makeLawMatrix(MakeLaw make_law)
+    {
+        typedef decltype(make_law(0, 0)) Law;
+        static_assert(std::is_trivially_destructible<Law>::value, "laws are released with the arena");
+        LawMatrix<Law> matrix = { static_cast<Law*>(FrameArena::instance().allocate(sizeof(Law) * GroupCount * GroupCount)) };
+        for (int i = 0; i < GroupCount; ++i)
+            for (int j = 0; j < GroupCount; ++j)
+                ::new (static_cast<void*>(matrix.laws + i * GroupCount + j)) Law(make_law(i, j));
+        return matrix;
+    }
+
+    // Per-group interaction radius of a law matrix.
+    template <typename Law>
+    inline void lawRadii(const LawMatrix<Law>& laws, float radius[GroupCount])
+    {
+        for (int i = 0; i < GroupCount; ++i)
+        {
+            float max_d2 = 0.0f;
+            for (int j = 0; j < GroupCount; ++j)
+                max_d2 = laws.row(i)[j].max_d2 > max_d2 ? laws.row(i)[j].max_d2 : max_d2;
+            radius[i] = sqrtf(max_d2);
+        }
+    }
+
+    // Gather over a UniformGrid: each particle only scans the cells within its
+    // group's radius. One cell is one task, so every particle is written by the
+    // thread that owns its cell; the balancer decides who owns what. On a torus
+    // the grid carries ghost images past the seams, so the scan itself never wraps.
+    template <typename MakeLaw>
+    inline void accumulateGridForces(const ParticleGroups& groups, const UniformGrid& grid, MakeLaw make_law, ThreadPool& pool, LoadBalancer& balancer, ForceBuffer& forces)
+    {
+        const GroupOffsets offsets(groups);
+        forces.reset(offsets.total());
+
+        const FrameArena::Scope scratch;
+        const auto laws = makeLawMatrix(make_law);
+        float radius[GroupCount];
+        int reach[GroupCount];
+        lawRadii(laws, radius);
+        for (int i = 0; i < GroupCount; ++i)
+            reach[i] = grid.reach(radius[i]);
+
+        balancer.run(pool, grid.cellCount(), [&](int cell) -> std::uint32_t
+        {
+            const int cx = cell % grid.columns;
+            const int cy = cell / grid.columns;
+            std::uint32_t pairs = 0;
+
+            for (const GridEntry* a = grid.cellBegin(cell); a != grid.cellEnd(cell); ++a)
+            {
+                if (a->index < 0)
+                    continue;   // ghost, only ever a neighbour
+
+                const auto* law_row = laws.row(a->group);
+                const int r = reach[a->group];
+                const int x0 = cx - r < 0 ? 0 : cx - r;
+                const int x1 = cx + r >= grid.columns ? grid.columns - 1 : cx + r;
+                const int y0 = cy - r < 0 ? 0 : cy - r;
+                const int y1 = cy + r >= grid.rows ? grid.rows - 1 : cy + r;
+                float fx = 0.0f;
+                float fy = 0.0f;
+
+                for (int ny = y0; ny <= y1; ++ny)
+                {
+                    // Cells of one row are contiguous, so the whole span is one run of entries.
+                    const GridEntry* b = grid.cellBegin(grid.cellIndex(x0, ny));
+                    const GridEntry* b_end = grid.cellEnd(grid.cellIndex(x1, ny));
+                    pairs += static_cast<std::uint32_t>(b_end - b);
+
+                    for (; b != b_end; ++b)
+                    {
+                        const float dx = a->x - b->x;
+                        const float dy = a->y - b->y;
+                        const float d2 = dx*dx + dy*dy;
+                        const auto& law = law_row[b->group];
+
+                        if (d2 > law.min_d2 && d2 < law.max_d2)
+                        {
+                            const float F = law.factor(d2, rsqrt(d2));
+                            fx += dx * F;
+                            fy += dy * F;
+                        }
+                    }
+                }
+                forces.fx[offsets[a->group] + a->index] = fx;
+                forces.fy[offsets[a->group] + a->index] = fy;
+            }
+            return pairs;
+        });
+    }
+
+    // Gather over a cell-sorted ParticleStore, every species in one pass. The
+    // run of species b in a row span of cells is contiguous, so each (a, b) pair
+    // of species scans its own runs with its law and reach fixed, reading only
+    // positions, and walks each span of the Layout with a pointer, so every
+    // Layout runs the same loop. Forces land in the store's fx, fy. Quantised
+    // reads the 16-bit positions instead, half the bytes per neighbour.
+    template <bool Quantised, typename Layout, typename MakeLaw>
+    inline void gatherStoreForces(ParticleStore<Layout>& store, MakeLaw make_law, ThreadPool& pool, LoadBalancer& balancer)
+    {
+        const FrameArena::Scope scratch;
+        const auto laws = makeLawMatrix(make_law);
+        int reach[GroupCount][GroupCount];
+        for (int a = 0; a < GroupCount; ++a)
+            for (int b = 0; b < GroupCount; ++b)
+                reach[a][b] = store.reach(sqrtf(laws.row(a)[b].max_d2));
+
+        // Law ranges in squared quanta, widened by one so the float test in add()
+        // decides the boundary cases.
+        std::int64_t range_q[GroupCount][GroupCount][2];
+        const double inv_q2 = 1.0 / (static_cast<double>(store.quantum) * store.quantum);
+        for (int a = 0; a < GroupCount; ++a)
+        {
+            for (int b = 0; b < GroupCount; ++b)
+            {
+                range_q[a][b][0] = static_cast<std::int64_t>(laws.row(a)[b].min_d2 * inv_q2) - 1;
+                range_q[a][b][1] = static_cast<std::int64_t>(std::min(laws.row(a)[b].max_d2 * inv_q2, 9.0e18)) + 1;
+            }
+        }
+
+        balancer.run(pool, store.cellCount(), [&](int cell) -> std::uint32_t
+        {
+            const int cx = cell % store.columns;
+            const int cy = cell / store.columns;
+            std::uint32_t pairs = 0;
+
+            for (int sa = 0; sa < GroupCount; ++sa)
+            {
+                for (int a = store.cellBegin(sa, cell); a < store.cellEnd(sa, cell); ++a)
+                {
+                    const float ax = store.x(a);
+                    const float ay = store.y(a);
+                    float fx = 0.0f;
+                    float fy = 0.0f;
+
+                    for (int sb = 0; sb < GroupCount; ++sb)
+                    {
+                        const auto& law = laws.row(sa)[sb];
+                        const auto add = [&](float dx, float dy)
+                        {
+                            const float d2 = dx*dx + dy*dy;
+                            if (d2 > law.min_d2 && d2 < law.max_d2)
+                            {
+                                const float F = law.factor(d2, rsqrt(d2));
+                                fx += dx * F;
+                                fy += dy * F;
+                            }
+                        };
+                        const int r = reach[sa][sb];
+                        const int x0 = cx - r < 0 ? 0 : cx - r;
+                        const int x1 = cx + r >= store.columns ? store.columns - 1 : cx + r;
+                        const int y0 = cy - r < 0 ? 0 : cy - r;
+                        const int y1 = cy + r >= store.rows ? store.rows - 1 : cy + r;
+
+                        for (int ny = y0; ny <= y1; ++ny)
+                        {
+                            const std::size_t b_end = store.cellEnd(sb, store.cellIndex(x1, ny));
+                            std::size_t b = store.cellBegin(sb, store.cellIndex(x0, ny));
+                            pairs += static_cast<std::uint32_t>(b_end - b);
+
+                            if (Quantised)
+                            {
+                                // Candidates are filtered on the integer squared distance, in
+                                // quanta; only those in range are converted to floats.
+                                const std::uint16_t* qa = store.quantised(a);
+                                const std::uint16_t* qb = store.quantised(b);
+                                for (; b < b_end; ++b, qb += 2)
+                                {
+                                    const int dx = qa[0] - qb[0];
+                                    const int dy = qa[1] - qb[1];
+                                    const std::int64_t d2 = static_cast<std::int64_t>(dx) * dx + static_cast<std::int64_t>(dy) * dy;
+                                    if (d2 > range_q[sa][sb][0] && d2 < range_q[sa][sb][1])
+                                        add(static_cast<float>(dx) * store.quantum, static_cast<float>(dy) * store.quantum);
+                                }
+                                continue;
+                            }
+
+                            while (b < b_end)
+                            {
+                                const std::size_t span_end = store.spanEnd(b, b_end);
+                                const float* bx = &store.x(b);
+                                const float* by = &store.y(b);
+                                for (; b < span_end; ++b, bx += store.Step, by += store.Step)
+                                    add(ax - *bx, ay - *by);
+                            }
+                        }
+                    }
+                    store.fx(a) = fx;
+                    store.fy(a) = fy;
+                }
+            }
+            return pairs;
+        });
+    }
+
+    template <typename Layout, typename MakeLaw>
+    inline void accumulateStoreForces(ParticleStore<Layout>& store, MakeLaw make_law, ThreadPool& pool, LoadBalancer& balancer)
+    {
+        if (store.quantised_load)
+            gatherStoreForces<true>(store, make_law, pool, balancer);
+        else
+            gatherStoreForces<false>(store, make_law, pool, balancer);
+    }
+
+    // Gather over a HashGrid. Neighbour cells cannot be walked as row spans, so
+    // each occupied cell looks every neighbour up once and runs its own particles
+    // against it, adding into their force slots.
+    template <typename MakeLaw>
+    inline void accumulateHashForces(const ParticleGroups& groups, const HashGrid& hash, MakeLaw make_law, ThreadPool& pool, LoadBalancer& balancer, ForceBuffer& forces)
+    {
+        const GroupOffsets offsets(groups);
+        forces.reset(offsets.total());
+
+        const FrameArena::Scope scratch;
+        const auto laws = makeLawMatrix(make_law);
+        float radius[GroupCount];
+        int reach[GroupCount];
+        lawRadii(laws, radius);
+        for (int i = 0; i < GroupCount; ++i)
+            reach[i] = hash.reach(radius[i]);
+
+        balancer.run(pool, hash.cellCount(), [&](int cell) -> std::uint32_t
+        {
+            const GridEntry* a_begin = hash.cellBegin(cell);
+            const GridEntry* a_end = hash.cellEnd(cell);
+            int cell_reach = 0;
+            for (const GridEntry* a = a_begin; a != a_end; ++a)
+                cell_reach = reach[a->group] > cell_reach ? reach[a->group] : cell_reach;
+
+            std::uint32_t pairs = 0;
+            for (int dy = -cell_reach; dy <= cell_reach; ++dy)
+            {
+                for (int dx = -cell_reach; dx <= cell_reach; ++dx)
+                {
+                    const int other = hash.find(hash.cellX(cell) + dx, hash.cellY(cell) + dy);
+                    if (other < 0)
+                        continue;
+
+                    const GridEntry* b_begin = hash.cellBegin(other);
+                    const GridEntry* b_end = hash.cellEnd(other);
+                    for (const GridEntry* a = a_begin; a != a_end; ++a)
+                    {
+                        const int r = reach[a->group];
+                        if (dx < -r || dx > r || dy < -r || dy > r)
+                            continue;
+
+                        const auto* law_row = laws.row(a->group);
+                        float fx = 0.0f;
+                        float fy = 0.0f;
+                        pairs += static_cast<std::uint32_t>(b_end - b_begin);
+
+                        for (const GridEntry* b = b_begin; b != b_end; ++b)
+                        {
+                            const float ex = a->x - b->x;
+                            const float ey = a->y - b->y;
+                            const float d2 = ex*ex + ey*ey;
+                            const auto& law = law_row[b->group];
+
+                            if (d2 > law.min_d2 && d2 < law.max_d2)
+                            {
+                                const float F = law.factor(d2, rsqrt(d2));
+                                fx += ex * F;
+                                fy += ey * F;
+                            }
+                        }
+                        forces.fx[offsets[a->group] + a->index] += fx;
+                        forces.fy[offsets[a->group] + a->index] += fy;
+                    }
+                }
+            }
+            return pairs;
+        });
+    }
+
+    // Gather over a QuadTree. A leaf is one task, pulled on demand since leaf
+    // sizes are bounded but neighbourhoods are not. Periodic images are searched as
+    // shifted queries. Returns the number of pairs examined.
+    template <typename MakeLaw, typename Boundary>
+    inline std::uint64_t accumulateTreeForces(const ParticleGroups& groups, const QuadTree& tree, MakeLaw make_law, const Boundary& boundary, ThreadPool& pool, ForceBuffer& forces)
+    {
+        const GroupOffsets offsets(groups);
+        forces.reset(offsets.total());
+
+        const FrameArena::Scope scratch;
+        const auto laws = makeLawMatrix(make_law);
+        float radius[GroupCount];
+        lawRadii(laws, radius);
+
+        const std::vector<int>& leaves = tree.leaves();
+        const int image_count = Boundary::Images * Boundary::Images;
+        std::uint64_t* pairs = FrameArena::instance().allocate<std::uint64_t>(pool.size());
+        std::fill(pairs, pairs + pool.size(), 0);
+
+        pool.parallelFor(leaves.size(), 1, [&](std::size_t begin, std::size_t end, int thread_index)
+        {
+            // Kept by each thread between calls, so it stops growing once warm.
+            static thread_local std::vector<int> nearby;
+            for (std::size_t l = begin; l < end; ++l)
+            {
+                const QuadNode& leaf = tree.node(leaves[l]);
+                float reach = 0.0f;
+                for (const GridEntry& a : leaf.entries)
+                    reach = radius[a.group] > reach ? radius[a.group] : reach;
+
+                // Image k of a neighbour sits at b + offset, so it is found by
+                // querying around the leaf shifted by -offset.
+                nearby.clear();
+                int image_end[Boundary::Images * Boundary::Images];
+                for (int k = 0; k < image_count; ++k)
+                {
+                    const float ox = boundary.imageX(k % Boundary::Images);
+                    const float oy = boundary.imageY(k / Boundary::Images);
+                    tree.query(leaf.x0 - ox - reach, leaf.y0 - oy - reach, leaf.x1 - ox + reach, leaf.y1 - oy + reach, nearby);
+                    image_end[k] = static_cast<int>(nearby.size());
+                }
+
+                for (const GridEntry& a : leaf.entries)
+                {
+                    const auto* law_row = laws.row(a.group);
+                    const float r = radius[a.group];
+                    float fx = 0.0f;
+                    float fy = 0.0f;
+
+                    for (int k = 0, first = 0; k < image_count; first = image_end[k++])
+                    {
+                        const float ax = a.x - boundary.imageX(k % Boundary::Images);
+                        const float ay = a.y - boundary.imageY(k / Boundary::Images);
+
+                        for (int n = first; n < image_end[k]; ++n)
+                        {
+                            const QuadNode& other = tree.node(nearby[n]);
+                            // Skip leaves out of this particle's reach.
+                            const float ex = ax < other.x0 ? other.x0 - ax : (ax > other.x1 ? ax - other.x1 : 0.0f);
+                            const float ey = ay < other.y0 ? other.y0 - ay : (ay > other.y1 ? ay - other.y1 : 0.0f);
+                            if (ex*ex + ey*ey >= r*r)
+                                continue;
+
+                            pairs[thread_index] += other.entries.size();
+                            for (const GridEntry& b : other.entries)
+                            {
+                                const float dx = ax - b.x;
+                                const float dy = ay - b.y;
+                                const float d2 = dx*dx + dy*dy;
+                                const auto& law = law_row[b.group];
+
+                                if (d2 > law.min_d2 && d2 < law.max_d2)
+                                {
+                                    const float F = law.factor(d2, rsqrt(d2));
+                                    fx += dx * F;
+                                    fy += dy * F;
+                                }
+                            }
+                        }
+                    }
+                    forces.fx[offsets[a.group] + a.index] = fx;
+                    forces.fy[offsets[a.group] + a.index] = fy;
+                }
+            }
+        });
+
+        std::uint64_t total = 0;
+        for (int t = 0; t < pool.size(); ++t)
+            total += pairs[t];
+        return total;
+    }
+
+    // Gather over SweepAndPrune. Rows of group i are walked in x order, so the
+    // window into each other group only slides forward; a chunk does one binary
+    // search to place it and then just advances it. On a torus each x image gets
+    // its own pass and y wraps through the minimum image. Returns the candidates
+    // examined.
+    template <typename MakeLaw, typename Boundary>
+    inline std::uint64_t accumulateSweepForces(const ParticleGroups& groups, const SweepAndPrune& sweep, MakeLaw make_law, const Boundary& boundary, ThreadPool& pool, ForceBuffer& forces)
+    {
+        const GroupOffsets offsets(groups);
+        forces.reset(offsets.total());
+
+        const FrameArena::Scope scratch;
+        const auto laws = makeLawMatrix(make_law);
+        float radius[GroupCount];
+        lawRadii(laws, radius);
+        std::uint64_t* pairs = FrameArena::instance().allocate<std::uint64_t>(pool.size());
+        std::fill(pairs, pairs + pool.size(), 0);
+
+        for (int i = 0; i < GroupCount; ++i)
+        {
+            const std::vector<AxisEntry>& rows = sweep.sorted(i);
+            const float r = radius[i];
+            float* out_x = forces.fx.data() + offsets[i];
+            float* out_y = forces.fy.data() + offsets[i];
+
+            pool.parallelFor(rows.size(), 256, [&](std::size_t begin, std::size_t end, int thread_index)
+            {
+                // One pass per (other group, x image).
+                for (int pass = 0; pass < GroupCount * Boundary::Images; ++pass)
+                {
+                    const int j = pass / Boundary::Images;
+                    const auto& law = laws.row(i)[j];
+                    const float ox = boundary.imageX(pass % Boundary::Images);
+                    const std::vector<AxisEntry>& others = sweep.sorted(j);
+                    const std::size_t count = others.size();
+                    std::size_t lo = std::lower_bound(others.begin(), others.end(), rows[begin].x - ox - r,
+                        [](const AxisEntry& e, float x) { return e.x < x; }) - others.begin();
+
+                    for (std::size_t k = begin; k < end; ++k)
+                    {
+                        const AxisEntry& a = rows[k];
+                        const float ax = a.x - ox;
+                        while (lo < count && others[lo].x <= ax - r)
+                            ++lo;
+
+                        float fx = 0.0f;
+                        float fy = 0.0f;
+                        std::size_t m = lo;
+                        for (; m < count && others[m].x < ax + r; ++m)
+                        {
+                            float dx = ax - others[m].x;
+                            float dy = a.y - others[m].y;
+                            boundary.minimumImage(dx, dy);
+                            const float d2 = dx*dx + dy*dy;
+
+                            if (d2 > law.min_d2 && d2 < law.max_d2)
+                            {
+                                const float F = law.factor(d2, rsqrt(d2));
+                                fx += dx * F;
+                                fy += dy * F;
+                            }
+                        }
+                        out_x[a.index] += fx;
+                        out_y[a.index] += fy;
+                        pairs[thread_index] += m - lo;
+                    }
+                }
+            });
+        }
+
+        std::uint64_t total = 0;
+        for (int t = 0; t < pool.size(); ++t)
+            total += pairs[t];
+        return total;
+    }
+
+    // Largest speed and largest force over all particles, for choosing a time
+    // step before integrating with these forces. One partial maximum per thread.
+    struct MotionBounds
+    {
+        float max_speed = 0.0f;
+        float max_force = 0.0f;
+    };
+
+    inline MotionBounds maxMotion(const ParticleGroups& groups, const ForceBuffer& forces, ThreadPool& pool)
+    {
+        const GroupOffsets offsets(groups);
+        const FrameArena::Scope scratch;
+        MotionBounds* partial = FrameArena::instance().allocate<MotionBounds>(pool.size());
+        for (int g = 0; g < GroupCount; ++g)
+        {
+            const auto& group = groups[g];
+            pool.parallelRanges(group.size(), [&](std::size_t begin, std::size_t end, int thread_index)
+            {
+                float v2 = 0.0f, f2 = 0.0f;
+                for (std::size_t k = begin; k < end; ++k)
+                {
+                    const auto& p = group[k];
+                    const float fx = forces.fx[offsets[g] + k], fy = forces.fy[offsets[g] + k];
+                    v2 = std::max(v2, p.vx * p.vx + p.vy * p.vy);
+                    f2 = std::max(f2, fx * fx + fy * fy);
+                }
+                MotionBounds& m = partial[thread_index];
+                m.max_speed = std::max(m.max_speed, v2);
+                m.max_force = std::max(m.max_force, f2);
+            });
+        }
+
+        MotionBounds bounds;
+        for (int t = 0; t < pool.size(); ++t)
+        {
+            const MotionBounds& m = partial[t];
+            bounds.max_speed = std::max(bounds.max_speed, m.max_speed);
+            bounds.max_force = std::max(bounds.max_force, m.max_force);
+        }
+        bounds.max_speed = sqrtf(bounds.max_speed);
+        bounds.max_force = sqrtf(bounds.max_force);
+        return bounds;
+    }
+
+    template <typename Layout>
+    inline MotionBounds maxMotion(const ParticleStore<Layout>& store, ThreadPool& pool)
+    {
+        const FrameArena::Scope scratch;
+        MotionBounds* partial = FrameArena::instance().allocate<MotionBounds>(pool.size());
+        pool.parallelRanges(store.particleCount(), [&](std::size_t begin, std::size_t end, int thread_index)
+        {
+            float v2 = 0.0f, f2 = 0.0f;
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                v2 = std::max(v2, store.vx(i) * store.vx(i) + store.vy(i) * store.vy(i));
+                f2 = std::max(f2, store.fx(i) * store.fx(i) + store.fy(i) * store.fy(i));
+            }
+            MotionBounds& m = partial[thread_index];
+            m.max_speed = std::max(m.max_speed, v2);
+            m.max_force = std::max(m.max_force, f2);
+        });
+
+        MotionBounds bounds;
+        for (int t = 0; t < pool.size(); ++t)
+        {
+            const MotionBounds& m = partial[t];
+            bounds.max_speed = std::max(bounds.max_speed, m.max_speed);
+            bounds.max_force = std::max(bounds.max_force, m.max_force);
+        }
+        bounds.max_speed = sqrtf(bounds.max_speed);
+        bounds.max_force = sqrtf(bounds.max_force);
+        return bounds;
+    }
+
+    // One loop over every species, in store order. Like the other streaming
+    // loops it runs on parallelRanges(), so each thread updates the pages that
+    // ParticleStore::load() had it touch first.
+    template <typename Layout, typename Boundary>
+    inline void integrateStore(ParticleStore<Layout>& store, const Boundary& boundary, const TimeStep& time, ThreadPool& pool)
+    {
+        pool.parallelRanges(store.particleCount(), [&](std::size_t begin, std::size_t end, int)
+        {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                ParticleObject p = { store.x(i), store.y(i), store.vx(i), store.vy(i), 0 };
+                boundary.integrate(p, store.fx(i), store.fy(i), time);
+                store.x(i) = p.x;
+                store.y(i) = p.y;
+                store.vx(i) = p.vx;
+                store.vy(i) = p.vy;
+            }
+        });
+    }
+
+    template <typename Boundary>
+    inline void integrateAll(ParticleGroups& groups, const ForceBuffer& forces, const Boundary& boundary, const TimeStep& time, ThreadPool& pool)
+    {
+        const GroupOffsets offsets(groups);
+        for (int g = 0; g < GroupCount; ++g)
+        {
+            auto& group = groups[g];
+            pool.parallelRanges(group.size(), [&](std::size_t begin, std::size_t end, int)
+            {
+                for (std::size_t k = begin; k < end; ++k)
+                    boundary.integrate(group[k], forces.fx[offsets[g] + k], forces.fy[offsets[g] + k], time);
+            });
+        }
+    }
+}
+
+#endif // INTEGRATOR_H
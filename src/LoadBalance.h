@@ -0,0 +1,107 @@
+#ifndef LOAD_BALANCE_H
+#define LOAD_BALANCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "PoolAllocator.h"
+#include "ThreadPool.h"
+
+namespace ParticleLife
+{
+    enum Balance
+    {
+        Balance_EqualCells,     // each thread gets the same number of cells
+        Balance_MeasuredCost,   // ranges cut so each thread gets the same pair count as last step
+        Balance_WorkStealing,   // small chunks of cells pulled on demand
+        Balance_COUNT
+    };
+
+    static const char* const BalanceNames[Balance_COUNT] = { "Equal cells", "Measured cost", "Work stealing" };
+
+    // Spreads per-cell tasks over the pool. Particle Life collapses into a few dense
+    // blobs, so equal cell ranges leave most threads idle; the measured mode uses
+    // each cell's pair count from the previous step as its cost estimate.
+    class LoadBalancer
+    {
+    public:
+        int mode = Balance_MeasuredCost;    // Balance_
+
+        // Runs process(cell) for every cell; process returns the number of pairs
+        // it examined, which becomes that cell's cost for the next step.
+        template <typename Fn>
+        void run(ThreadPool& pool, int cell_count, Fn process)
+        {
+            const bool costs_valid = cell_cost.size() == static_cast<std::size_t>(cell_count);
+            if (!costs_valid)
+            {
+                reserveGrowing(cell_cost, cell_count);
+                cell_cost.assign(cell_count, 0);
+            }
+
+            if (mode == Balance_WorkStealing)
+            {
+                pool.parallelFor(cell_count, 4, [&](std::size_t begin, std::size_t end, int)
+                {
+                    for (std::size_t c = begin; c < end; ++c)
+                        cell_cost[c] = process(static_cast<int>(c));
+                });
+                return;
+            }
+
+            partition(cell_count, pool.size(), mode == Balance_MeasuredCost && costs_valid);
+            pool.run([&](int thread_index)
+            {
+                for (int c = bounds[thread_index]; c < bounds[thread_index + 1]; ++c)
+                    cell_cost[c] = process(c);
+            });
+        }
+
+        // Pairs examined in the last run().
+        std::uint64_t totalCost() const
+        {
+            std::uint64_t total = 0;
+            for (std::uint32_t cost : cell_cost)
+                total += cost;
+            return total;
+        }
+
+        // Drops the measured costs; the next run() splits evenly.
+        void invalidate() { cell_cost.clear(); }
+
+        // Cell range [bounds[t], bounds[t + 1]) of each thread in the last static split.
+        const std::vector<int>& ranges() const { return bounds; }
+
+    private:
+        void partition(int cell_count, int threads, bool weighted)
+        {
+            bounds.assign(threads + 1, cell_count);
+            bounds[0] = 0;
+            if (!weighted)
+            {
+                for (int t = 1; t < threads; ++t)
+                    bounds[t] = static_cast<int>(static_cast<long long>(cell_count) * t / threads);
+                return;
+            }
+
+            // Every cell costs at least 1 so empty regions still get split up.
+            std::uint64_t total = 0;
+            for (std::uint32_t cost : cell_cost)
+                total += cost + 1;
+
+            std::uint64_t prefix = 0;
+            int t = 1;
+            for (int c = 0; c < cell_count && t < threads; ++c)
+            {
+                prefix += cell_cost[c] + 1;
+                while (t < threads && prefix * threads >= total * t)
+                    bounds[t++] = c + 1;
+            }
+        }
+
+        std::vector<std::uint32_t> cell_cost;
+        std::vector<int> bounds;
+    };
+}
+
+#endif // LOAD_BALANCE_H
@@ -0,0 +1,315 @@
+#ifndef PARTICLE_LIFE_H
+#define PARTICLE_LIFE_H
+
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <math.h>
+#include "ParticleObject.h"
+#include "FastMath.h"
+#include "ForceProfile.h"
+#include "ForceLaw.h"
+#include "PoolAllocator.h"
+#include "Random.h"
+
+namespace ParticleLife
+{
+    const int GroupCount = 4;
+
+    // One species. Storage comes from the shared BlockPool, 64-byte aligned.
+    typedef std::vector<ParticleObject, PoolAllocator<ParticleObject>> ParticleVector;
+    typedef std::array<ParticleVector, GroupCount> ParticleGroups;
+
+    struct Params
+    {
+        float radius[GroupCount];
+        float forces[GroupCount][GroupCount];   // forces[i][j]: g applied to group i by group j
+    };
+
+    enum Boundary
+    {
+        Boundary_Walls,     // velocities reflect at the walls
+        Boundary_Periodic,  // wrap around; buffered integrator only, elsewhere walls
+        Boundary_Open,      // no walls at all, particles may drift anywhere
+        Boundary_COUNT
+    };
+
+    static const char* const BoundaryNames[Boundary_COUNT] = { "Walls", "Periodic", "Open" };
+
+    // Extent of the simulated world, shared by spawning, the boundary, the spatial
+    // indexes and the canvas. Positions run over [0, width) x [0, height); walls
+    // reflect velocities wall_margin short of the far edges, which in the default
+    // 1400 x 1200 world is the original 1390/1190.
+    struct WorldBounds
+    {
+        float width = 1400.0f;
+        float height = 1200.0f;
+        float wall_margin = 10.0f;
+        int boundary = Boundary_Walls;  // Boundary_
+
+        float wallX() const { return width - wall_margin; }
+        float wallY() const { return height - wall_margin; }
+
+        // A world with factor times the area, so factor times the particles keep
+        // the same density.
+        WorldBounds scaled(float factor) const
+        {
+            WorldBounds bounds = *this;
+            bounds.width *= sqrtf(factor);
+            bounds.height *= sqrtf(factor);
+            return bounds;
+        }
+    };
+
+    // Explicit integration step. Forces act per unit time and a velocity keeps
+    // 0.8 of itself per unit time, so dt = 1 is exactly the original per-frame
+    // update v = (v + F) * 0.8, x += v.
+    struct TimeStep
+    {
+        float dt;
+        float retain;   // 0.8^dt, velocity kept after damping over one step
+
+        explicit TimeStep(float dt = 1.0f) : dt(dt), retain(powf(1.0f - 0.2f, dt)) {}
+    };
+
+    // Groups laid out one after the other in flat per-particle arrays such as
+    // force buffers; group g starts at offsets[g].
+    struct GroupOffsets
+    {
+        std::size_t offsets[GroupCount + 1];
+
+        explicit GroupOffsets(const ParticleGroups& groups)
+        {
+            offsets[0] = 0;
+            for (int g = 0; g < GroupCount; ++g)
+                offsets[g + 1] = offsets[g] + groups[g].size();
+        }
+
+        GroupOffsets() : offsets() {}
+
+        std::size_t operator[](int g) const { return offsets[g]; }
+        std::size_t total() const { return offsets[GroupCount]; }
+
+        // Same group sizes, so (group, index) pairs of one still hold for the other.
+        bool operator==(const GroupOffsets& other) const
+        {
+            for (int g = 1; g <= GroupCount; ++g)
+                if (offsets[g] != other.offsets[g])
+                    return false;
+            return true;
+        }
+        bool operator!=(const GroupOffsets& other) const { return !(*this == other); }
+    };
+
+    inline Params defaultParams()
+    {
+        return Params{
+            { 455.0f, 112.0f, 80.0f, 150.0f },
+            {
+                { -0.1501f,   -0.372f,  -0.432f,   -0.00344f },
+                { -0.00015f,   0.0f,    -0.00051f, -0.00035f },
+                {  0.1381f,    0.321f,  -0.9f,     -0.2304f  },
+                { -0.4151f,    0.0006f, -0.4142f,  -0.251f   },
+            }
+        };
+    }
+
+    // One ForceTable per (group, other group) pair, rebuilt only when the inputs change.
+    struct ForceTables
+    {
+        int shape = ForceShape_Constant;    // ForceShape_
+        float core = 0.3f;
+        ForceTable tables[GroupCount][GroupCount];
+
+        bool update(const Params& params)
+        {
+            if (built && built_shape == shape && built_core == core && memcmp(&built_params, &params, sizeof(Params)) == 0)
+                return false;
+
+            for (int i = 0; i < GroupCount; ++i)
+                for (int j = 0; j < GroupCount; ++j)
+                    tables[i][j].build(static_cast<ForceShape>(shape), params.forces[i][j], params.radius[i], core);
+
+            built = true;
+            built_shape = shape;
+            built_core = core;
+            built_params = params;
+            return true;
+        }
+
+    private:
+        bool built = false;
+        int built_shape;
+        float built_core;
+        Params built_params;
+    };
+
+    // Particle k of the group (its index once added) takes draws 2k and 2k + 1
+    // of rng, so a group holds the same particles however it was filled.
+    inline void addPoints(ParticleVector& particles, int n, float x_max, float y_max, ImU32 color, const Random& rng)
+    {
+        const std::size_t first = particles.size();
+        particles.resize(first + n);
+        for (std::size_t k = first; k < first + n; ++k)
+            particles[k] = {rng.uniformAt(2 * k) * x_max, rng.uniformAt(2 * k + 1) * y_max, 0.0f, 0.0f, color};
+    }
+
+    // Reference kernel. Kept as-is so the faster variants can be checked against it.
+    inline void rule(ParticleVector& group1, const ParticleVector& group2, float g, const float& radius, const WorldBounds& world, const TimeStep& time)
+    {
+        const double retain = pow(1.0 - 0.2, time.dt);
+
+        for (std::size_t i = 0; i < group1.size(); ++i)
+        {
+            auto& a = group1[i];
+            float fx = 0;
+            float fy = 0;
+
+            for (std::size_t j = 0; j < group2.size(); ++j)
+            {
+                const auto& b = group2[j];
+                const auto dx = a.x - b.x;
+                const auto dy = a.y - b.y;
+                const auto d = std::sqrt(dx*dx + dy*dy);
+
+                float F = 0.0f;
+                if (d > 12.0f && d < radius)
+                {
+                    F = (g / d);
+                    fx += dx * F;
+                    fy += dy * F;
+                }
+            }
+            a.vx = (a.vx + fx * time.dt) * retain;
+            a.vy = (a.vy + fy * time.dt) * retain;
+            if (world.boundary != Boundary_Open)
+            {
+                if (a.x < 0.0f && a.vx < 0) a.vx *= -1.0;
+                if (a.x > world.wallX() && a.vx > 0) a.vx *= -1.0;
+                if (a.y < 0.0f && a.vy < 0) a.vy *= -1.0;
+                if (a.y > world.wallY() && a.vy > 0) a.vy *= -1.0;
+            }
+            a.x += a.vx * time.dt;
+            a.y += a.vy * time.dt;
+        }
+    }
+
+    // Damping and wall reflection (none in an open world) shared by the float kernels.
+    inline void integrate(ParticleObject& a, float fx, float fy, const WorldBounds& world, const TimeStep& time)
+    {
+        a.vx = (a.vx + fx * time.dt) * time.retain;
+        a.vy = (a.vy + fy * time.dt) * time.retain;
+        if (world.boundary != Boundary_Open)
+        {
+            if (a.x < 0.0f && a.vx < 0.0f) a.vx = -a.vx;
+            if (a.x > world.wallX() && a.vx > 0.0f) a.vx = -a.vx;
+            if (a.y < 0.0f && a.vy < 0.0f) a.vy = -a.vy;
+            if (a.y > world.wallY() && a.vy > 0.0f) a.vy = -a.vy;
+        }
+        a.x += a.vx * time.dt;
+        a.y += a.vy * time.dt;
+    }
+
+    // Same interaction as rule() but the cutoff is tested on the squared distance,
+    // so rejected pairs never pay for a sqrt, and 1/d comes from rsqrt() only for
+    // accepted pairs. The integration is kept in float throughout.
+    inline void ruleFast(ParticleVector& group1, const ParticleVector& group2, float g, const float& radius, const WorldBounds& world, const TimeStep& time)
+    {
+        const float min_d2 = 12.0f * 12.0f;
+        const float max_d2 = radius * radius;
+
+        for (std::size_t i = 0; i < group1.size(); ++i)
+        {
+            auto& a = group1[i];
+            float fx = 0.0f;
+            float fy = 0.0f;
+
+            for (std::size_t j = 0; j < group2.size(); ++j)
+            {
+                const auto& b = group2[j];
+                const float dx = a.x - b.x;
+                const float dy = a.y - b.y;
+                const float d2 = dx*dx + dy*dy;
+
+                if (d2 > min_d2 && d2 < max_d2)
+                {
+                    const float F = g * rsqrt(d2);
+                    fx += dx * F;
+                    fy += dy * F;
+                }
+            }
+            integrate(a, fx, fy, world, time);
+        }
+    }
+
+    // ruleFast() with the force law as a compile-time policy (see ForceLaw.h), so
+    // each law gets its own fully inlined loop and nothing is dispatched per pair.
+    template <typename Law>
+    inline void ruleLaw(ParticleVector& group1, const ParticleVector& group2, const Law& law, const WorldBounds& world, const TimeStep& time)
+    {
+        const float min_d2 = law.min_d2;
+        const float max_d2 = law.max_d2;
+
+        for (std::size_t i = 0; i < group1.size(); ++i)
+        {
+            auto& a = group1[i];
+            float fx = 0.0f;
+            float fy = 0.0f;
+
+            for (std::size_t j = 0; j < group2.size(); ++j)
+            {
+                const auto& b = group2[j];
+                const float dx = a.x - b.x;
+                const float dy = a.y - b.y;
+                const float d2 = dx*dx + dy*dy;
+
+                if (d2 > min_d2 && d2 < max_d2)
+                {
+                    const float F = law.factor(d2, rsqrt(d2));
+                    fx += dx * F;
+                    fy += dy * F;
+                }
+            }
+            integrate(a, fx, fy, world, time);
+        }
+    }
+
+    // Applies every group pair in order, each group seeing the already updated
+    // positions of the groups before it, like the original main loop.
+    // make_law(i, j) builds the policy for group i under the influence of group j.
+    template <typename MakeLaw>
+    inline void applyRules(ParticleGroups& groups, MakeLaw make_law, const WorldBounds& world, const TimeStep& time)
+    {
+        for (int i = 0; i < GroupCount; ++i)
+        {
+            if (groups[i].empty())
+                continue;
+
+            for (int j = 0; j < GroupCount; ++j)
+                ruleLaw(groups[i], groups[j], make_law(i, j), world, time);
+        }
+    }
+
+    enum Kernel
+    {
+        Kernel_Reference,   // rule()
+        Kernel_Fast,        // ruleFast(), hand-written constant law
+        Kernel_Table,       // ruleLaw<TableLaw>, any ForceShape
+        Kernel_Law,         // ruleLaw<...>, analytic ForceLaw
+        Kernel_COUNT
+    };
+
+    static const char* const KernelNames[Kernel_COUNT] = { "Reference", "Fast (rsqrt)", "Force table", "Force law" };
+
+    inline void move(ParticleVector& particles)
+    {
+        for (auto& p : particles)
+        {
+            p.x += p.vx;
+            p.y += p.vy;
+        }
+    }
+}
+
+#endif // PARTICLE_LIFE_H
@@ -0,0 +1,342 @@
+#ifndef PARTICLE_STORE_H
+#define PARTICLE_STORE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <math.h>
+#include "ParticleLife.h"
+#include "PoolAllocator.h"
+#include "ThreadPool.h"
+
+namespace ParticleLife
+{
+    enum StoreField
+    {
+        StoreField_X,
+        StoreField_Y,
+        StoreField_VX,
+        StoreField_VY,
+        StoreField_FX,      // force being accumulated
+        StoreField_FY,
+        StoreField_COUNT
+    };
+
+    // Layouts of the float fields of a ParticleStore. Each maps (particle, field)
+    // into a block of floats(n) floats that the store owns, so the layout is a
+    // compile-time choice. Within [i, spanEnd(i, end)) positions sit Step floats
+    // apart, which lets an inner loop walk a pointer instead of redoing at<F>().
+
+    // Array of structures: one particle's six floats are adjacent, as in
+    // ParticleObject. A position load drags the other four fields along.
+    struct LayoutAoS
+    {
+        static const char* name() { return "AoS"; }
+        static std::size_t floats(std::size_t n) { return StoreField_COUNT * n; }
+        static const int Step = StoreField_COUNT;
+        static std::size_t spanEnd(std::size_t, std::size_t end) { return end; }
+
+        void bind(float* block, std::size_t) { base = block; }
+        template <int F> float& at(std::size_t i) { return base[i * StoreField_COUNT + F]; }
+        template <int F> float at(std::size_t i) const { return base[i * StoreField_COUNT + F]; }
+
+        float* base = nullptr;
+    };
+
+    // Structure of arrays: one array per field, each padded to whole cache lines.
+    struct LayoutSoA
+    {
+        static const char* name() { return "SoA"; }
+        static std::size_t stride(std::size_t n) { return (n + 15) & ~static_cast<std::size_t>(15); }
+        static std::size_t floats(std::size_t n) { return StoreField_COUNT * stride(n); }
+        static const int Step = 1;
+        static std::size_t spanEnd(std::size_t, std::size_t end) { return end; }
+
+        void bind(float* block, std::size_t n)
+        {
+            base = block;
+            pitch = stride(n);
+        }
+        template <int F> float& at(std::size_t i) { return base[F * pitch + i]; }
+        template <int F> float at(std::size_t i) const { return base[F * pitch + i]; }
+
+        float* base = nullptr;
+        std::size_t pitch = 0;
+    };
+
+    // Blocked SoA: Width particles per block, each field a lane array of Width
+    // floats, so a block of positions fills whole vector registers while a
+    // particle's fields stay within one small block.
+    template <int Width>
+    struct LayoutAoSoA
+    {
+        static const char* name()
+        {
+            static const std::string label = "AoSoA " + std::to_string(Width);
+            return label.c_str();
+        }
+        static std::size_t floats(std::size_t n) { return StoreField_COUNT * Width * ((n + Width - 1) / Width); }
+        static const int Step = 1;
+        static std::size_t spanEnd(std::size_t i, std::size_t end) { return std::min(end, (i / Width + 1) * Width); }
+
+        void bind(float* block, std::size_t) { base = block; }
+        template <int F> float& at(std::size_t i) { return base[(i / Width) * (StoreField_COUNT * Width) + F * Width + i % Width]; }
+        template <int F> float at(std::size_t i) const { return base[(i / Width) * (StoreField_COUNT * Width) + F * Width + i % Width]; }
+
+        float* base = nullptr;
+    };
+
+    // Hot/cold split: x, y pairs in one dense array, everything else in a second
+    // one. The gather only reads neighbour positions, so a cache line carries 8
+    // neighbours instead of the 3 of a ParticleObject, and velocity and force
+    // are not pulled in until the particle's own update. Only the store is
+    // split; ParticleObject keeps all its fields together, and load() reads
+    // and scatter() writes every one of them.
+    struct LayoutHotCold
+    {
+        static const int Hot = 2;
+        static const int Cold = StoreField_COUNT - Hot;
+
+        static const char* name() { return "Hot/cold"; }
+        static std::size_t hotFloats(std::size_t n) { return (Hot * n + 15) & ~static_cast<std::size_t>(15); }
+        static std::size_t floats(std::size_t n) { return hotFloats(n) + Cold * n; }
+        static const int Step = Hot;
+        static std::size_t spanEnd(std::size_t, std::size_t end) { return end; }
+
+        void bind(float* block, std::size_t n)
+        {
+            hot = block;
+            cold = block + hotFloats(n);
+        }
+        template <int F> float& at(std::size_t i) { return F < Hot ? hot[i * Hot + F] : cold[i * Cold + F - Hot]; }
+        template <int F> float at(std::size_t i) const { return F < Hot ? hot[i * Hot + F] : cold[i * Cold + F - Hot]; }
+
+        float* hot = nullptr;
+        float* cold = nullptr;
+    };
+
+    // Every species in one allocation: the float fields (x, y, vx, vy and the
+    // force being accumulated) in the Layout's arrangement, then the species
+    // bytes. Species follow each other, so species g is the index range
+    // [begin(g), end(g)) and a kernel can sweep all particles in one loop.
+    //
+    // load() also sorts each species' range by grid cell, row by row, so the
+    // store doubles as a cell list over all species: the particles of species s
+    // in a row span of cells are one contiguous run, and a kernel can scan it
+    // with that pair's law fixed and nothing but positions in the loop.
+    //
+    // The groups stay the owners of the particles: every step copies them in
+    // with load(), which counting-sorts each species again, and back out with
+    // scatter(). That traffic is linear in the particle count and is paid on
+    // top of the force sweep, so a layout's gain over the Groups path is what
+    // its sweep saves minus both copies; the layout bench times them apart.
+    template <typename Layout>
+    class ParticleStore
+    {
+    public:
+        // Copies the groups in, bucketed by cells of cell_size over the particles'
+        // current extent. pool places fresh storage, see allocate().
+        void load(const ParticleGroups& groups, float cell_size, ThreadPool& pool)
+        {
+            float min_x = 0.0f, min_y = 0.0f, max_x = 0.0f, max_y = 0.0f;
+            bool first = true;
+            for (const auto& group : groups)
+            {
+                for (const auto& p : group)
+                {
+                    if (first)
+                    {
+                        min_x = max_x = p.x;
+                        min_y = max_y = p.y;
+                        first = false;
+                    }
+                    min_x = std::min(min_x, p.x); max_x = std::max(max_x, p.x);
+                    min_y = std::min(min_y, p.y); max_y = std::max(max_y, p.y);
+                }
+            }
+
+            size = cell_size;
+            inv_size = 1.0f / cell_size;
+            origin_x = min_x;
+            origin_y = min_y;
+            columns = static_cast<int>((max_x - min_x) * inv_size) + 1;
+            rows = static_cast<int>((max_y - min_y) * inv_size) + 1;
+
+            const float extent = std::max(max_x - min_x, max_y - min_y);
+            quantum = extent > 0.0f ? extent / 65535.0f : 1.0f;
+            const float inv_quantum = 1.0f / quantum;
+            quantised_load = quantise && quantum <= MaxQuantum;
+
+            const GroupOffsets offsets(groups);
+            allocate(offsets.total(), pool);
+            const int cells = cellCount();
+            reserveGrowing(cell_start, static_cast<std::size_t>(GroupCount) * (cells + 1));
+            reserveGrowing(fill, cells);
+            cell_start.assign(static_cast<std::size_t>(GroupCount) * (cells + 1), 0);
+            for (int g = 0; g < GroupCount; ++g)
+            {
+                range[g] = offsets[g];
+                range[g + 1] = offsets[g + 1];
+
+                // Counting sort of the species into its range.
+                int* start = cell_start.data() + static_cast<std::size_t>(g) * (cells + 1);
+                const auto& group = groups[g];
+                cell_of.resize(group.size());
+                for (std::size_t i = 0; i < group.size(); ++i)
+                {
+                    cell_of[i] = cellIndex(cellX(group[i].x), cellY(group[i].y));
+                    ++start[cell_of[i] + 1];
+                }
+                start[0] = static_cast<int>(offsets[g]);
+                for (int c = 0; c < cells; ++c)
+                    start[c + 1] += start[c];
+
+                fill.assign(start, start + cells);
+                for (std::size_t i = 0; i < group.size(); ++i)
+                {
+                    const int slot = fill[cell_of[i]]++;
+                    const auto& p = group[i];
+                    x(slot) = p.x;
+                    y(slot) = p.y;
+                    vx(slot) = p.vx;
+                    vy(slot) = p.vy;
+                    species[slot] = static_cast<std::uint8_t>(g);
+                    origin[slot] = static_cast<int>(i);
+                    if (quantised_load)
+                    {
+                        qpos[2 * slot] = static_cast<std::uint16_t>(std::min((p.x - min_x) * inv_quantum + 0.5f, 65535.0f));
+                        qpos[2 * slot + 1] = static_cast<std::uint16_t>(std::min((p.y - min_y) * inv_quantum + 0.5f, 65535.0f));
+                    }
+                }
+            }
+        }
+
+        // Writes positions and velocities back to where each particle came from.
+        void scatter(ParticleGroups& groups, ThreadPool& pool) const
+        {
+            pool.parallelRanges(count, [&](std::size_t begin, std::size_t end, int)
+            {
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    ParticleObject& p = groups[species[i]][origin[i]];
+                    p.x = x(i);
+                    p.y = y(i);
+                    p.vx = vx(i);
+                    p.vy = vy(i);
+                }
+            });
+        }
+
+        std::size_t particleCount() const { return count; }
+        std::size_t begin(int g) const { return range[g]; }
+        std::size_t end(int g) const { return range[g + 1]; }
+
+        int cellCount() const { return columns * rows; }
+        int cellIndex(int cx, int cy) const { return cy * columns + cx; }
+        int cellX(float px) const { return static_cast<int>(std::min(std::max(0.0f, (px - origin_x) * inv_size), static_cast<float>(columns - 1))); }
+        int cellY(float py) const { return static_cast<int>(std::min(std::max(0.0f, (py - origin_y) * inv_size), static_cast<float>(rows - 1))); }
+        int reach(float radius) const { return static_cast<int>(ceilf(radius * inv_size)); }
+
+        // Store indices of species g in cell, or in a row span of cells.
+        int cellBegin(int g, int cell) const { return cell_start[static_cast<std::size_t>(g) * (cellCount() + 1) + cell]; }
+        int cellEnd(int g, int cell) const { return cell_start[static_cast<std::size_t>(g) * (cellCount() + 1) + cell + 1]; }
+
+        float& x(std::size_t i) { return layout.template at<StoreField_X>(i); }
+        float& y(std::size_t i) { return layout.template at<StoreField_Y>(i); }
+        float& vx(std::size_t i) { return layout.template at<StoreField_VX>(i); }
+        float& vy(std::size_t i) { return layout.template at<StoreField_VY>(i); }
+        float& fx(std::size_t i) { return layout.template at<StoreField_FX>(i); }
+        float& fy(std::size_t i) { return layout.template at<StoreField_FY>(i); }
+        float x(std::size_t i) const { return layout.template at<StoreField_X>(i); }
+        float y(std::size_t i) const { return layout.template at<StoreField_Y>(i); }
+        float vx(std::size_t i) const { return layout.template at<StoreField_VX>(i); }
+        float vy(std::size_t i) const { return layout.template at<StoreField_VY>(i); }
+        float fx(std::size_t i) const { return layout.template at<StoreField_FX>(i); }
+        float fy(std::size_t i) const { return layout.template at<StoreField_FY>(i); }
+
+        // x, y of particle i as multiples of quantum from (origin_x, origin_y);
+        // valid after a load() that left quantised_load set.
+        const std::uint16_t* quantised(std::size_t i) const { return qpos.data() + 2 * i; }
+
+        // Particles [i, spanEnd(i, end)) have their positions Step floats apart.
+        static const int Step = Layout::Step;
+        static std::size_t spanEnd(std::size_t i, std::size_t end) { return Layout::spanEnd(i, end); }
+
+        std::uint8_t* species = nullptr;    // valid until the next load()
+
+        // When set, load() also keeps 16-bit positions, one step for both axes
+        // across the particles' extent (0.025 units on the default world), for
+        // kernels that only need distances. Past MaxQuantum, an extent of about
+        // 6500 units, the step would start to blur the short-range forces, so
+        // load() keeps floats only and clears quantised_load. The float fields
+        // stay as they are and are what integration uses. The halved gather is small next to
+        // the full-width copies in and out, and has not paid for itself in the
+        // layout bench.
+        bool quantise = false;
+        bool quantised_load = false;    // the last load() kept 16-bit positions
+        float quantum = 1.0f;
+        static constexpr float MaxQuantum = 0.1f;
+
+        float size = 1.0f;
+        float inv_size = 1.0f;
+        float origin_x = 0.0f;
+        float origin_y = 0.0f;
+        int columns = 0;
+        int rows = 0;
+
+    private:
+        // One block for everything; the species bytes start on a cache line.
+        // Only grows. PoolAllocator leaves a fresh block unwritten, so the first
+        // write to each page comes from the thread whose parallelRanges() range
+        // holds it, which under first-touch NUMA placement keeps every thread's
+        // particles on its own node for integrateStore() and scatter().
+        void allocate(std::size_t n, ThreadPool& pool)
+        {
+            count = n;
+            const std::size_t floats = (Layout::floats(n) + 15) & ~static_cast<std::size_t>(15);
+            const bool fresh = buffer.size() < floats + (n + 3) / 4 || (quantise && qpos.size() < 2 * n);
+            if (buffer.size() < floats + (n + 3) / 4)
+            {
+                buffer.clear();
+                buffer.resize(floats + (n + 3) / 4);
+            }
+            if (quantise && qpos.size() < 2 * n)
+            {
+                qpos.clear();
+                qpos.resize(2 * n);
+            }
+            layout.bind(buffer.data(), n);
+            species = reinterpret_cast<std::uint8_t*>(buffer.data() + floats);
+            origin.resize(n);
+
+            if (fresh)
+            {
+                pool.parallelRanges(n, [&](std::size_t begin, std::size_t end, int)
+                {
+                    for (std::size_t i = begin; i < end; ++i)
+                    {
+                        x(i) = y(i) = vx(i) = vy(i) = fx(i) = fy(i) = 0.0f;
+                        species[i] = 0;
+                        if (quantise)
+                            qpos[2 * i] = qpos[2 * i + 1] = 0;
+                    }
+                });
+            }
+        }
+
+        Layout layout;
+        std::vector<float, PoolAllocator<float>> buffer;
+        std::vector<int> origin;        // index within its group
+        std::vector<std::uint16_t, PoolAllocator<std::uint16_t>> qpos;  // x, y pairs when quantise
+        std::size_t count = 0;
+        std::size_t range[GroupCount + 1] = {};
+        std::vector<int> cell_start;    // GroupCount x (cellCount() + 1), store indices
+
+        std::vector<int> cell_of;       // load scratch
+        std::vector<int> fill;          // load scratch
+    };
+}
+
+#endif // PARTICLE_STORE_H
@@ -0,0 +1,237 @@
+#ifndef POOL_ALLOCATOR_H
+#define POOL_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+#include <mutex>
+#include <new>
+#include <utility>
+#include "AllocationTracker.h"
+
+namespace ParticleLife
+{
+    // 64-byte aligned blocks in power-of-two size classes. A freed block goes on
+    // its class's free list and is handed out again, so vectors that grow and
+    // shrink (groups being resized, respawned or swapping particles) trade
+    // blocks with each other instead of going back to the heap every time.
+    // Blocks are only returned to the heap by trim().
+    //
+    // On Linux, blocks of a huge page or more are mapped directly, aligned to
+    // huge pages, and with huge_pages set are advised as transparent huge pages:
+    // a million-particle array then spans a dozen TLB entries instead of
+    // thousands of 4 KiB pages. Mapped pages are only backed when first written,
+    // which is what lets ThreadPool::parallelRanges() place them on NUMA nodes.
+    class BlockPool
+    {
+    public:
+        static const std::size_t Alignment = 64;
+        static const std::size_t HugePage = std::size_t(2) << 20;
+
+        static BlockPool& instance()
+        {
+            static BlockPool pool;
+            return pool;
+        }
+
+        ~BlockPool() { trim(); }
+
+        void* allocate(std::size_t bytes)
+        {
+            const int c = sizeClass(bytes);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (FreeBlock* block = free_lists[c])
+            {
+                free_lists[c] = block->next;
+                in_use += classBytes(c);
+                ++live[c];
+                ++reuses;
+                return block;
+            }
+
+            void* block = takeFromHeap(c);
+            if (!block)
+                throw std::bad_alloc();
+
+            // Out of this class: stock half as many again as are in use, so a
+            // demand that creeps up a block at a time (quadtree leaves, say)
+            // reaches the heap a few times in all rather than at every new
+            // maximum. Huge blocks are taken one at a time.
+            if (classBytes(c) < HugePage)
+            {
+                for (std::size_t k = live[c] / 2; k > 0; --k)
+                {
+                    void* spare = takeFromHeap(c);
+                    if (!spare)
+                        break;
+                    free_lists[c] = ::new (spare) FreeBlock{ free_lists[c] };
+                }
+            }
+            in_use += classBytes(c);
+            ++live[c];
+            return block;
+        }
+
+        void deallocate(void* block, std::size_t bytes)
+        {
+            const int c = sizeClass(bytes);
+            std::lock_guard<std::mutex> lock(mutex);
+            in_use -= classBytes(c);
+            --live[c];
+            free_lists[c] = ::new (block) FreeBlock{ free_lists[c] };
+        }
+
+        // Returns every free block to the heap.
+        void trim()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (int c = 0; c < ClassCount; ++c)
+            {
+                while (FreeBlock* block = free_lists[c])
+                {
+                    free_lists[c] = block->next;
+                    heapFree(block, classBytes(c));
+                    reserved -= classBytes(c);
+                }
+            }
+        }
+
+        // Bytes held from the heap and bytes handed out; the difference is on free lists.
+        std::size_t reserved = 0;
+        std::size_t in_use = 0;
+        std::size_t heap_allocations = 0;
+        std::size_t reuses = 0;
+        std::size_t advised = 0;            // bytes mapped with huge_pages, whether or not the kernel obliged
+
+        bool huge_pages = false;            // applies to blocks mapped from now on
+
+    private:
+        static const int ClassCount = 48;
+
+        // A free block holds the link to the next one, so freeing never allocates.
+        struct FreeBlock
+        {
+            FreeBlock* next;
+        };
+
+        // Smallest class holding bytes; class c is Alignment << c bytes.
+        static int sizeClass(std::size_t bytes)
+        {
+            int c = 0;
+            while ((Alignment << c) < bytes)
+                ++c;
+            return c;
+        }
+
+        static std::size_t classBytes(int c) { return Alignment << c; }
+
+        void* takeFromHeap(int c)
+        {
+            void* block = heapAllocate(classBytes(c), huge_pages);
+            if (!block)
+                return nullptr;
+            reserved += classBytes(c);
+            ++heap_allocations;
+            AllocationTracker::instance().record(classBytes(c));
+            if (huge_pages && classBytes(c) >= HugePage)
+                advised += classBytes(c);
+            return block;
+        }
+
+        static void* heapAllocate(std::size_t bytes, bool advise)
+        {
+#if defined(_MSC_VER)
+            (void)advise;
+            return _aligned_malloc(bytes, Alignment);
+#elif defined(__linux__)
+            if (bytes < HugePage)
+                return aligned_alloc(Alignment, bytes);
+
+            // Over-map by a huge page and trim both ends to align.
+            const std::size_t span = bytes + HugePage;
+            void* mapped = mmap(nullptr, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (mapped == MAP_FAILED)
+                return nullptr;
+            char* raw = static_cast<char*>(mapped);
+            char* block = reinterpret_cast<char*>((reinterpret_cast<std::uintptr_t>(raw) + HugePage - 1) & ~static_cast<std::uintptr_t>(HugePage - 1));
+            if (block > raw)
+                munmap(raw, block - raw);
+            if (raw + span > block + bytes)
+                munmap(block + bytes, raw + span - (block + bytes));
+            if (advise)
+                madvise(block, bytes, MADV_HUGEPAGE);
+            return block;
+#else
+            (void)advise;
+            return aligned_alloc(Alignment, bytes);
+#endif
+        }
+
+        static void heapFree(void* block, std::size_t bytes)
+        {
+#if defined(_MSC_VER)
+            (void)bytes;
+            _aligned_free(block);
+#elif defined(__linux__)
+            if (bytes < HugePage)
+                free(block);
+            else
+                munmap(block, bytes);
+#else
+            (void)bytes;
+            free(block);
+#endif
+        }
+
+        FreeBlock* free_lists[ClassCount] = {};
+        std::size_t live[ClassCount] = {};  // blocks handed out, per class
+        std::mutex mutex;
+    };
+
+    // Makes room for n elements, growing the capacity by at least half. assign()
+    // allocates exactly what it is asked for, so a size that creeps up now and
+    // then (a grid following the particles' extent) would otherwise reallocate
+    // at every new maximum, long after warm-up.
+    template <typename Vector>
+    inline void reserveGrowing(Vector& v, std::size_t n)
+    {
+        if (n > v.capacity())
+            v.reserve(n > v.capacity() + v.capacity() / 2 ? n : v.capacity() + v.capacity() / 2);
+    }
+
+    // Standard allocator on top of the shared BlockPool. Elements made without
+    // arguments are default-initialised, so a resize() leaves plain floats and
+    // particles unwritten for whoever fills them, and fresh pages stay untouched.
+    template <typename T>
+    struct PoolAllocator
+    {
+        typedef T value_type;
+        template <typename U>
+        struct rebind { typedef PoolAllocator<U> other; };
+
+        PoolAllocator() = default;
+        template <typename U>
+        PoolAllocator(const PoolAllocator<U>&) {}
+
+        T* allocate(std::size_t n) { return static_cast<T*>(BlockPool::instance().allocate(n * sizeof(T))); }
+        void deallocate(T* p, std::size_t n) { BlockPool::instance().deallocate(p, n * sizeof(T)); }
+
+        template <typename U>
+        void construct(U* p) { ::new (static_cast<void*>(p)) U; }
+        template <typename U, typename... Args>
+        void construct(U* p, Args&&... args) { ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...); }
+
+        template <typename U>
+        bool operator==(const PoolAllocator<U>&) const { return true; }
+        template <typename U>
+        bool operator!=(const PoolAllocator<U>&) const { return false; }
+    };
+}
+
+#endif // POOL_ALLOCATOR_H
@@ -0,0 +1,308 @@
+#ifndef QUAD_TREE_H
+#define QUAD_TREE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include "ParticleLife.h"
+#include "PoolAllocator.h"
+#include "SpatialGrid.h"
+
+namespace ParticleLife
+{
+    typedef std::vector<GridEntry, PoolAllocator<GridEntry>> QuadEntries;
+
+    struct QuadNode
+    {
+        float x0, y0, x1, y1;           // [x0, x1) x [y0, y1)
+        int first_child = -1;           // four consecutive nodes, -1 for a leaf
+        int parent = -1;
+        int depth = 0;
+        QuadEntries entries;            // leaves only
+    };
+
+    // Adaptive spatial index: leaves split when they get crowded and sibling leaves
+    // merge back when they empty out, so a collapsed cluster ends up spread over
+    // many small leaves instead of one huge cell. The tree persists between steps;
+    // update() only moves particles that left their leaf. Leaf entry lists come
+    // from the BlockPool and a node hands its list back when it stops being a
+    // leaf, so blocks circulate between leaves instead of every node keeping the
+    // largest list it ever held.
+    class QuadTree
+    {
+    public:
+        int split_threshold = 32;   // split a leaf holding more than this
+        int merge_threshold = 12;   // merge four leaf siblings holding at most this; below split for hysteresis
+        int max_depth = 12;
+
+        // Stats of the last update().
+        std::size_t migrated = 0;
+        bool rebuilt = false;
+
+        void update(const ParticleGroups& groups)
+        {
+            const GroupOffsets offsets(groups);
+            rebuilt = false;
+            migrated = 0;
+            // where[] is indexed by group offsets, so any group changing size
+            // invalidates it, even if the total stays the same.
+            if (nodes.empty() || offsets != layout)
+            {
+                rebuild(groups);
+                return;
+            }
+
+            const QuadNode& root = nodes[0];
+            moving.clear();
+            for (int g = 0; g < GroupCount; ++g)
+            {
+                for (std::size_t i = 0; i < groups[g].size(); ++i)
+                {
+                    const auto& p = groups[g][i];
+                    if (!(p.x >= root.x0 && p.x < root.x1 && p.y >= root.y0 && p.y < root.y1))
+                    {
+                        rebuild(groups);
+                        return;
+                    }
+
+                    const std::size_t id = offsets[g] + i;
+                    QuadNode& leaf = nodes[where[id].node];
+                    if (p.x >= leaf.x0 && p.x < leaf.x1 && p.y >= leaf.y0 && p.y < leaf.y1)
+                    {
+                        leaf.entries[where[id].slot].x = p.x;
+                        leaf.entries[where[id].slot].y = p.y;
+                    }
+                    else
+                    {
+                        remove(where[id].node, where[id].slot, offsets);
+                        moving.push_back({ p.x, p.y, g, static_cast<int>(i) });
+                    }
+                }
+            }
+
+            migrated = moving.size();
+            for (const GridEntry& e : moving)
+                insert(e, offsets);
+
+            restructure(0, offsets);
+            collectLeaves();
+        }
+
+        // Forces a rebuild on the next update().
+        void invalidate() { nodes.clear(); }
+
+        void rebuild(const ParticleGroups& groups)
+        {
+            const GroupOffsets offsets(groups);
+            float min_x = 0.0f, min_y = 0.0f, max_x = 1.0f, max_y = 1.0f;
+            bool first = true;
+            for (const auto& group : groups)
+            {
+                for (const auto& p : group)
+                {
+                    if (first)
+                    {
+                        min_x = max_x = p.x;
+                        min_y = max_y = p.y;
+                        first = false;
+                    }
+                    min_x = std::min(min_x, p.x); max_x = std::max(max_x, p.x);
+                    min_y = std::min(min_y, p.y); max_y = std::max(max_y, p.y);
+                }
+            }
+
+            // Square root with some slack, so particles bouncing off the walls do
+            // not force a rebuild every step.
+            const float side = std::max(max_x - min_x, max_y - min_y) * 1.2f + 1.0f;
+            const float cx = 0.5f * (min_x + max_x), cy = 0.5f * (min_y + max_y);
+
+            nodes.clear();
+            free_blocks.clear();
+            nodes.emplace_back();
+            nodes[0].x0 = cx - 0.5f * side; nodes[0].x1 = cx + 0.5f * side;
+            nodes[0].y0 = cy - 0.5f * side; nodes[0].y1 = cy + 0.5f * side;
+
+            layout = offsets;
+            where.assign(offsets.total(), Location());
+            for (int g = 0; g < GroupCount; ++g)
+                for (std::size_t i = 0; i < groups[g].size(); ++i)
+                    insert({ groups[g][i].x, groups[g][i].y, g, static_cast<int>(i) }, offsets);
+
+            restructure(0, offsets);
+            collectLeaves();
+            rebuilt = true;
+            migrated = offsets.total();
+        }
+
+        const std::vector<int>& leaves() const { return leaf_list; }
+        const QuadNode& node(int n) const { return nodes[n]; }
+
+        // Appends every non-empty leaf overlapping [x0, x1] x [y0, y1].
+        void query(float x0, float y0, float x1, float y1, std::vector<int>& out) const
+        {
+            int stack[64 * 4];
+            int top = 0;
+            stack[top++] = 0;
+            while (top > 0)
+            {
+                const int n = stack[--top];
+                const QuadNode& q = nodes[n];
+                if (q.x1 < x0 || q.x0 > x1 || q.y1 < y0 || q.y0 > y1)
+                    continue;
+                if (q.first_child < 0)
+                {
+                    if (!q.entries.empty())
+                        out.push_back(n);
+                    continue;
+                }
+                for (int c = 0; c < 4; ++c)
+                    stack[top++] = q.first_child + c;
+            }
+        }
+
+    private:
+        struct Location
+        {
+            int node = -1;
+            int slot = -1;
+        };
+
+        static int quadrant(const QuadNode& q, float x, float y)
+        {
+            return (x >= 0.5f * (q.x0 + q.x1) ? 1 : 0) + (y >= 0.5f * (q.y0 + q.y1) ? 2 : 0);
+        }
+
+        void insert(const GridEntry& e, const GroupOffsets& offsets)
+        {
+            int n = 0;
+            while (nodes[n].first_child >= 0)
+                n = nodes[n].first_child + quadrant(nodes[n], e.x, e.y);
+            nodes[n].entries.push_back(e);
+            where[offsets[e.group] + e.index] = { n, static_cast<int>(nodes[n].entries.size()) - 1 };
+        }
+
+        void remove(int n, int slot, const GroupOffsets& offsets)
+        {
+            auto& entries = nodes[n].entries;
+            entries[slot] = entries.back();
+            entries.pop_back();
+            if (slot < static_cast<int>(entries.size()))
+                where[offsets[entries[slot].group] + entries[slot].index].slot = slot;
+        }
+
+        int allocateChildren(int parent)
+        {
+            int first;
+            if (!free_blocks.empty())
+            {
+                first = free_blocks.back();
+                free_blocks.pop_back();
+            }
+            else
+            {
+                first = static_cast<int>(nodes.size());
+                nodes.resize(nodes.size() + 4);
+            }
+
+            const QuadNode& p = nodes[parent];
+            const float mx = 0.5f * (p.x0 + p.x1), my = 0.5f * (p.y0 + p.y1);
+            for (int c = 0; c < 4; ++c)
+            {
+                QuadNode& child = nodes[first + c];
+                child.x0 = (c & 1) ? mx : p.x0;  child.x1 = (c & 1) ? p.x1 : mx;
+                child.y0 = (c & 2) ? my : p.y0;  child.y1 = (c & 2) ? p.y1 : my;
+                child.first_child = -1;
+                child.parent = parent;
+                child.depth = p.depth + 1;
+                child.entries.clear();
+            }
+            return first;
+        }
+
+        // Total particles below n, or -1 if n has grandchildren (not mergeable).
+        int mergeableCount(int n) const
+        {
+            int total = 0;
+            for (int c = 0; c < 4; ++c)
+            {
+                const QuadNode& child = nodes[nodes[n].first_child + c];
+                if (child.first_child >= 0)
+                    return -1;
+                total += static_cast<int>(child.entries.size());
+            }
+            return total;
+        }
+
+        // Splits crowded leaves and merges sparse sibling leaves below n.
+        void restructure(int n, const GroupOffsets& offsets)
+        {
+            if (nodes[n].first_child < 0)
+            {
+                if (static_cast<int>(nodes[n].entries.size()) <= split_threshold || nodes[n].depth >= max_depth)
+                    return;
+
+                const int first = allocateChildren(n);
+                nodes[n].first_child = first;
+                QuadEntries splitting;
+                splitting.swap(nodes[n].entries);
+                for (const GridEntry& e : splitting)
+                {
+                    QuadNode& child = nodes[first + quadrant(nodes[n], e.x, e.y)];
+                    child.entries.push_back(e);
+                    where[offsets[e.group] + e.index] = { static_cast<int>(&child - nodes.data()), static_cast<int>(child.entries.size()) - 1 };
+                }
+            }
+
+            const int first = nodes[n].first_child;
+            for (int c = 0; c < 4; ++c)
+                restructure(first + c, offsets);
+
+            const int total = mergeableCount(n);
+            if (total >= 0 && total <= merge_threshold)
+            {
+                auto& entries = nodes[n].entries;
+                entries.reserve(total);
+                for (int c = 0; c < 4; ++c)
+                {
+                    for (const GridEntry& e : nodes[first + c].entries)
+                    {
+                        entries.push_back(e);
+                        where[offsets[e.group] + e.index] = { n, static_cast<int>(entries.size()) - 1 };
+                    }
+                    QuadEntries().swap(nodes[first + c].entries);
+                }
+                nodes[n].first_child = -1;
+                free_blocks.push_back(first);
+            }
+        }
+
+        void collectLeaves()
+        {
+            leaf_list.clear();
+            stack.assign(1, 0);
+            while (!stack.empty())
+            {
+                const int n = stack.back();
+                stack.pop_back();
+                if (nodes[n].first_child < 0)
+                {
+                    if (!nodes[n].entries.empty())
+                        leaf_list.push_back(n);
+                    continue;
+                }
+                for (int c = 0; c < 4; ++c)
+                    stack.push_back(nodes[n].first_child + c);
+            }
+        }
+
+        std::vector<QuadNode> nodes;
+        std::vector<int> free_blocks;       // first index of unused 4-node blocks
+        std::vector<Location> where;        // per particle, indexed like a ForceBuffer
+        GroupOffsets layout;                // group sizes at the last rebuild
+        std::vector<int> leaf_list;
+        std::vector<GridEntry> moving;      // update scratch
+        std::vector<int> stack;             // collectLeaves scratch
+    };
+}
+
+#endif // QUAD_TREE_H
@@ -0,0 +1,45 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <cstdint>
+
+namespace ParticleLife
+{
+    // Counter-based generator: draw k of a stream is a pure function of
+    // (seed, stream, k), so any thread can draw any value without shared state
+    // and the result does not depend on which thread draws it or in what order.
+    // Unlike rand() the sequence is the same on every platform.
+    class Random
+    {
+    public:
+        explicit Random(std::uint64_t seed = 0, std::uint64_t stream = 0)
+            : key(mix(mix(seed) ^ (stream * 0xD1B54A32D192ED03ull)))
+        {
+        }
+
+        // SplitMix64 finaliser over the key and the counter.
+        std::uint64_t at(std::uint64_t k) const { return mix(key + k * 0x9E3779B97F4A7C15ull); }
+
+        // Uniform in [0, 1) with 24 bits, every value exactly representable.
+        float uniformAt(std::uint64_t k) const { return static_cast<float>(at(k) >> 40) * (1.0f / 16777216.0f); }
+
+        // Sequential use: each call advances the counter by one.
+        std::uint64_t next() { return at(counter++); }
+        float uniform() { return uniformAt(counter++); }
+        float uniform(float max) { return uniform() * max; }
+
+        std::uint64_t counter = 0;
+
+    private:
+        static std::uint64_t mix(std::uint64_t z)
+        {
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+
+        std::uint64_t key;
+    };
+}
+
+#endif // RANDOM_H
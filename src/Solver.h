@@ -0,0 +1,410 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "ParticleLife.h"
+#include "Boundary.h"
+#include "Integrator.h"
+#include "LoadBalance.h"
+#include "FrameArena.h"
+#include "ParticleStore.h"
+#include "HashGrid.h"
+#include "QuadTree.h"
+#include "SpatialGrid.h"
+#include "SweepAndPrune.h"
+#include "ThreadPool.h"
+
+namespace ParticleLife
+{
+    enum Integrator
+    {
+        Integrator_Sequential,  // rule() order: each group moves before the next group is evaluated
+        Integrator_Buffered,    // all forces from one snapshot, then one integration (Integrator.h)
+        Integrator_COUNT
+    };
+
+    static const char* const IntegratorNames[Integrator_COUNT] = { "Sequential", "Buffered" };
+
+    enum Spatial
+    {
+        Spatial_BruteForce,     // every particle against every particle
+        Spatial_Grid,           // UniformGrid cell list
+        Spatial_QuadTree,       // adaptive QuadTree, updated incrementally
+        Spatial_SweepAndPrune,  // groups sorted by x, scan the x-window
+        Spatial_HashGrid,       // sparse HashGrid for open or huge worlds; periodic worlds use the uniform grid
+        Spatial_COUNT
+    };
+
+    static const char* const SpatialNames[Spatial_COUNT] = { "Brute force", "Uniform grid", "Quadtree", "Sweep and prune", "Hashed grid" };
+
+    enum Storage
+    {
+        Storage_Groups,         // kernels read the groups directly
+        Storage_AoS,            // copied into one cell-sorted ParticleStore and back each step, fields interleaved
+        Storage_SoA,            // same, one array per field
+        Storage_AoSoA,          // same, blocks of 8 particles with one lane array per field
+        Storage_HotCold,        // same, positions dense and apart from velocity and force
+        Storage_COUNT
+    };
+
+    static const char* const StorageNames[Storage_COUNT] = { "Groups", "Unified AoS", "Unified SoA", "Unified AoSoA", "Unified hot/cold" };
+
+    inline int defaultThreadCount()
+    {
+        const unsigned int n = std::thread::hardware_concurrency();
+        return n > 0 ? static_cast<int>(n) : 1;
+    }
+
+    struct Solver
+    {
+        int kernel = Kernel_Fast;                   // Kernel_
+        int law = ForceLaw_Constant;                // ForceLaw_, for Kernel_Law
+        LawSettings law_settings;                   // for Kernel_Law
+        ForceTables tables;                         // for Kernel_Table
+        int integrator = Integrator_Sequential;     // Integrator_
+        bool newton_pairs = false;                  // Integrator_Buffered + Spatial_BruteForce: visit each unordered pair once
+        bool deterministic = false;                 // Integrator_Buffered: same bits for any thread count
+        int threads = defaultThreadCount();         // Integrator_Buffered
+        int pinning = Pinning_None;                 // Pinning_, Integrator_Buffered
+        int spatial = Spatial_BruteForce;           // Spatial_, Integrator_Buffered
+        float cell_size = 0.0f;                     // Spatial_Grid, Spatial_HashGrid; 0 uses the smallest radius
+        LoadBalancer balancer;                      // Spatial_Grid, Spatial_HashGrid
+        UniformGrid grid;                           // Spatial_Grid, kept between steps when incremental
+        int storage = Storage_Groups;               // Storage_, Spatial_Grid without Boundary_Periodic
+        ParticleStore<LayoutAoS> store_aos;         // Storage_AoS
+        ParticleStore<LayoutSoA> store_soa;         // Storage_SoA
+        ParticleStore<LayoutAoSoA<8>> store_aosoa;  // Storage_AoSoA
+        ParticleStore<LayoutHotCold> store_split;   // Storage_HotCold
+        bool quantised = false;                     // Storage_ other than Groups, Boundary_Walls: distances from 16-bit positions
+        HashGrid hash;                              // Spatial_HashGrid
+        QuadTree tree;                              // Spatial_QuadTree, kept between steps
+        SweepAndPrune sweep;                        // Spatial_SweepAndPrune, kept between steps
+        WorldBounds world;                          // Boundary_Periodic needs Integrator_Buffered
+        float dt = 1.0f;                            // simulated time per step(); 1 is the original frame step
+        int substeps = 1;                           // integration steps per step(), each dt / substeps
+        bool adaptive = false;                      // Integrator_Buffered: each substep sized by max_move, dt is ignored
+        float max_move = 20.0f;                     // adaptive: furthest any particle may travel in one substep
+        float min_dt = 0.05f;                       // adaptive bounds on the substep
+        float max_dt = 8.0f;
+
+        MotionBounds motion;                        // adaptive, of the last substep
+        float last_dt = 1.0f;                       // last substep actually taken
+        float quantum = 0.0f;                       // quantised: position step of the last substep, 0 if it fell back to floats
+
+        double simulated_time = 0.0;                // sum of all substeps taken
+        std::vector<float> thread_busy_ms;          // per thread, last buffered step
+        std::size_t heap_allocations = 0;           // last step(): blocks the FrameArena and the BlockPool took from the heap
+
+        // Per-step scratch comes from the FrameArena, which is reset here, and
+        // particle and store arrays from the BlockPool; once both have grown to
+        // what the scene needs, heap_allocations stays 0. Buffers that keep their
+        // capacity between steps (force buffers, grid and index arrays) only
+        // allocate while they grow, and are outside this count.
+        void step(ParticleGroups& groups, const Params& params)
+        {
+            FrameArena& arena = FrameArena::instance();
+            arena.reset();
+            const std::size_t arena_start = arena.heap_allocations;
+            const std::size_t pool_start = BlockPool::instance().heap_allocations;
+
+            const TimeStep time(dt / substeps);
+            if (integrator == Integrator_Buffered)
+            {
+                ThreadPool& workers = threadPool();
+                workers.resetBusyTimes();
+                for (int s = 0; s < substeps; ++s)
+                {
+                    substepBuffered(groups, params, time, workers);
+                    simulated_time += last_dt;
+                }
+
+                thread_busy_ms.resize(workers.size());
+                for (int t = 0; t < workers.size(); ++t)
+                    thread_busy_ms[t] = static_cast<float>(workers.busyTimes()[t] * 1000.0);
+            }
+            else
+            {
+                last_dt = time.dt;
+                for (int s = 0; s < substeps; ++s)
+                    substepSequential(groups, params, time);
+                simulated_time += dt;
+            }
+
+            heap_allocations = (arena.heap_allocations - arena_start) + (BlockPool::instance().heap_allocations - pool_start);
+        }
+
+        // After the particles were replaced wholesale. The incremental indices
+        // would otherwise patch up a layout that no longer resembles them, and the
+        // measured costs belong to the old clusters. Buffers keep their capacity.
+        void invalidate()
+        {
+            grid.invalidate();
+            tree.invalidate();
+            sweep.invalidate();
+            balancer.invalidate();
+            simulated_time = 0.0;
+        }
+
+        // Also used by whatever fills the groups, e.g. a Spawner.
+        ThreadPool& threadPool()
+        {
+            if (!pool || pool->size() != threads)
+                pool = std::make_shared<ThreadPool>(threads);
+            if (pool->pinning != pinning)
+                pool->pin(pinning);
+            return *pool;
+        }
+
+    private:
+        // Dispatches once per substep; every branch below runs a loop specialised
+        // for its kernel and force law.
+        void substepBuffered(ParticleGroups& groups, const Params& params, const TimeStep& time, ThreadPool& workers)
+        {
+            visitLaw(params, [&](auto make_law)
+            {
+                if (world.boundary != Boundary_Periodic)
+                {
+                    stepBuffered(groups, params, make_law, Walls(world), time, workers);
+                    return;
+                }
+
+                // Particles spawned or left outside the torus are folded in
+                // first, and radii are capped so only the nearest image counts.
+                const Torus torus(world);
+                for (auto& group : groups)
+                    for (auto& p : group)
+                        torus.wrap(p);
+                const float max_d2 = torus.maxRadius() * torus.maxRadius();
+                stepBuffered(groups, params, [&](int i, int j)
+                {
+                    auto law = make_law(i, j);
+                    law.max_d2 = law.max_d2 < max_d2 ? law.max_d2 : max_d2;
+                    return law;
+                }, torus, time, workers);
+            });
+        }
+
+        void substepSequential(ParticleGroups& groups, const Params& params, const TimeStep& time)
+        {
+            switch (kernel)
+            {
+            case Kernel_Reference:
+            case Kernel_Fast:
+                for (int i = 0; i < GroupCount; ++i)
+                {
+                    if (groups[i].empty())
+                        continue;
+
+                    for (int j = 0; j < GroupCount; ++j)
+                    {
+                        if (kernel == Kernel_Reference)
+                            rule(groups[i], groups[j], params.forces[i][j], params.radius[i], world, time);
+                        else
+                            ruleFast(groups[i], groups[j], params.forces[i][j], params.radius[i], world, time);
+                    }
+                }
+                break;
+            default:
+                visitLaw(params, [&](auto make_law) { applyRules(groups, make_law, world, time); });
+                break;
+            }
+        }
+
+        template <typename MakeLaw, typename Boundary>
+        void stepBuffered(ParticleGroups& groups, const Params& params, MakeLaw make_law, const Boundary& boundary, const TimeStep& time, ThreadPool& workers)
+        {
+            if (spatial == Spatial_Grid && storage != Storage_Groups && Boundary::Images == 1)
+            {
+                // The store is its own cell list and integrates in place.
+                visitStore([&](auto& store)
+                {
+                    // Open worlds have no bound on the extent, and so none on the step.
+                    store.quantise = quantised && world.boundary == Boundary_Walls;
+                    store.load(groups, gridCellSize(params), workers);
+                    quantum = store.quantised_load ? store.quantum : 0.0f;
+                    accumulateStoreForces(store, make_law, workers, balancer);
+                    const TimeStep step = adaptive ? adaptiveStep(maxMotion(store, workers)) : time;
+                    last_dt = step.dt;
+                    integrateStore(store, boundary, step, workers);
+                    store.scatter(groups, workers);
+                });
+                return;
+            }
+
+            if (spatial == Spatial_HashGrid && Boundary::Images == 1)
+            {
+                force_buffers.resize(1);
+                hash.build(groups, gridCellSize(params));
+                accumulateHashForces(groups, hash, make_law, workers, balancer, force_buffers[0]);
+            }
+            else if (spatial == Spatial_Grid || spatial == Spatial_HashGrid)
+            {
+                force_buffers.resize(1);
+                updateGrid(groups, params, boundary, workers);
+                accumulateGridForces(groups, grid, make_law, workers, balancer, force_buffers[0]);
+            }
+            else if (spatial == Spatial_QuadTree)
+            {
+                force_buffers.resize(1);
+                tree.update(groups);
+                accumulateTreeForces(groups, tree, make_law, boundary, workers, force_buffers[0]);
+            }
+            else if (spatial == Spatial_SweepAndPrune)
+            {
+                force_buffers.resize(1);
+                sweep.update(groups, workers);
+                accumulateSweepForces(groups, sweep, make_law, boundary, workers, force_buffers[0]);
+            }
+            else if (newton_pairs)
+            {
+                accumulatePairForces(groups, make_law, boundary, workers, force_buffers, deterministic ? DeterministicLanes : 0);
+            }
+            else
+            {
+                force_buffers.resize(1);
+                accumulateForces(groups, make_law, boundary, workers, force_buffers[0]);
+            }
+            const TimeStep step = adaptive ? adaptiveStep(maxMotion(groups, force_buffers[0], workers)) : time;
+            last_dt = step.dt;
+            integrateAll(groups, force_buffers[0], boundary, step, workers);
+        }
+
+        // Largest step in which the fastest particle, pushed by the largest force,
+        // moves at most max_move: the positive root of v dt + F dt^2 = max_move.
+        TimeStep adaptiveStep(const MotionBounds& bounds)
+        {
+            motion = bounds;
+            const float v = motion.max_speed, f = motion.max_force;
+            const float denominator = v + sqrtf(v * v + 4.0f * f * max_move);
+            const float step = denominator > 0.0f ? 2.0f * max_move / denominator : max_dt;
+            return TimeStep(std::min(std::max(step, min_dt), max_dt));
+        }
+
+        void updateGrid(const ParticleGroups& groups, const Params& params, const Walls&, ThreadPool& workers)
+        {
+            grid.update(groups, gridCellSize(params), workers);
+        }
+
+        // Ghosts only need to reach as far as the largest radius.
+        void updateGrid(const ParticleGroups& groups, const Params& params, const Torus& boundary, ThreadPool&)
+        {
+            float largest = params.radius[0];
+            for (int g = 1; g < GroupCount; ++g)
+                largest = params.radius[g] > largest ? params.radius[g] : largest;
+            grid.update(groups, gridCellSize(params), boundary, largest);
+        }
+
+        // Calls fn(make_law) with make_law(i, j) building the policy for the selected
+        // kernel, so fn is instantiated once per law.
+        template <typename Fn>
+        void visitLaw(const Params& params, Fn fn)
+        {
+            const LawSettings& settings = law_settings;
+            switch (kernel)
+            {
+            case Kernel_Reference:
+                fn([&](int i, int j) { return ReferenceLaw(params.forces[i][j], params.radius[i], settings); });
+                break;
+            case Kernel_Fast:
+                fn([&](int i, int j) { return ConstantLaw(params.forces[i][j], params.radius[i], settings); });
+                break;
+            case Kernel_Table:
+                tables.update(params);
+                fn([&](int i, int j) { return TableLaw(tables.tables[i][j]); });
+                break;
+            case Kernel_Law:
+                switch (law)
+                {
+                case ForceLaw_Constant:
+                    fn([&](int i, int j) { return ConstantLaw(params.forces[i][j], params.radius[i], settings); });
+                    break;
+                case ForceLaw_LinearFalloff:
+                    fn([&](int i, int j) { return LinearFalloffLaw(params.forces[i][j], params.radius[i], settings); });
+                    break;
+                case ForceLaw_LennardJones:
+                    fn([&](int i, int j) { return LennardJonesLaw(params.forces[i][j], params.radius[i], settings); });
+                    break;
+                default:
+                    break;
+                }
+                break;
+            default:
+                break;
+            }
+        }
+
+        // Calls fn(store) with the ParticleStore of the selected storage layout.
+        template <typename Fn>
+        void visitStore(Fn fn)
+        {
+            switch (storage)
+            {
+            case Storage_AoS:
+                fn(store_aos);
+                break;
+            case Storage_AoSoA:
+                fn(store_aosoa);
+                break;
+            case Storage_HotCold:
+                fn(store_split);
+                break;
+            default:
+                fn(store_soa);
+                break;
+            }
+        }
+
+        float gridCellSize(const Params& params) const
+        {
+            if (cell_size > 0.0f)
+                return cell_size;
+            float smallest = params.radius[0];
+            for (int g = 1; g < GroupCount; ++g)
+                smallest = params.radius[g] < smallest ? params.radius[g] : smallest;
+            return smallest;
+        }
+
+        // Force buffers of deterministic Newton pairs, independent of the thread count.
+        static const int DeterministicLanes = 16;
+
+        std::shared_ptr<ThreadPool> pool;       // shared by copies, which must not step concurrently
+        std::vector<ForceBuffer> force_buffers; // one per thread for newton_pairs, else just [0]
+    };
+
+    // Decouples simulation speed from frame rate: wall-clock time is banked
+    // and spent in whole steps of 1 / rate seconds. A frame that falls more than
+    // max_steps behind drops the rest instead of trying to catch up, which would
+    // only make the next frame slower still.
+    struct FixedStepClock
+    {
+        float rate = 60.0f;         // steps per wall-clock second
+        int max_steps = 4;          // per advance()
+
+        double accumulator = 0.0;   // seconds banked towards the next step
+        int steps = 0;              // returned by the last advance()
+        bool dropped = false;       // the last advance() hit max_steps
+
+        int advance(double seconds)
+        {
+            const double period = 1.0 / rate;
+            accumulator += seconds;
+            steps = static_cast<int>(accumulator / period);
+            dropped = steps > max_steps;
+            if (dropped)
+            {
+                steps = max_steps;
+                accumulator = 0.0;
+            }
+            else
+            {
+                accumulator -= steps * period;
+            }
+            return steps;
+        }
+    };
+}
+
+#endif // SOLVER_H
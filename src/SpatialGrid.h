@@ -0,0 +1,319 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "ParticleLife.h"
+#include "Boundary.h"
+#include "ThreadPool.h"
+
+namespace ParticleLife
+{
+    // Compact copy of a particle as seen by the neighbour search.
+    struct GridEntry
+    {
+        float x;
+        float y;
+        int group;
+        int index;  // index within its group, ~index for a ghost
+    };
+
+    // Cell list over all groups, rebuilt with a counting sort. Entries of one
+    // cell are contiguous and cells are stored row by row.
+    //
+    // In incremental mode the grid keeps its geometry between steps and update()
+    // only relocates the particles whose cell changed, which after the first few
+    // steps is a small fraction. A full rebuild still runs every rebuild_interval
+    // steps to refit the bounds.
+    //
+    // On a torus the grid also holds ghost cells: a band around the world filled
+    // with shifted copies of the particles near the opposite seam. Ghost entries
+    // have index ~i (always negative).
+    class UniformGrid
+    {
+    public:
+        bool incremental = false;
+        int rebuild_interval = 64;
+
+        // Stats of the last update().
+        float migrated_fraction = 1.0f;
+        bool rebuilt = true;
+
+        void update(const ParticleGroups& groups, float cell_size, ThreadPool& pool)
+        {
+            // A relocation reuses the stored (group, index) pairs, which only hold
+            // while every group keeps its size; the total alone can stay the same
+            // with one group grown and another shrunk.
+            if (!incremental || entries.empty() || GroupOffsets(groups) != layout || cell_size != size || ++steps_since_build >= rebuild_interval)
+            {
+                // A cell of slack keeps particles drifting off the edge out of the
+                // clamped border cells until the next refit.
+                build(groups, cell_size, incremental ? cell_size : 0.0f);
+                steps_since_build = 0;
+                migrated_fraction = 1.0f;
+                rebuilt = true;
+                return;
+            }
+
+            relocate(groups, pool);
+            rebuilt = false;
+        }
+
+        // Periodic variant, always a full rebuild. The ghost band is margin wide,
+        // at most half the world so that a particle is never ghosted both ways.
+        void update(const ParticleGroups& groups, float cell_size, const Torus& torus, float margin)
+        {
+            margin = std::min(margin, torus.maxRadius());
+            layout = GroupOffsets();    // ghost entries; never relocated
+            staged.clear();
+            for (int g = 0; g < GroupCount; ++g)
+            {
+                for (std::size_t i = 0; i < groups[g].size(); ++i)
+                {
+                    const auto& p = groups[g][i];
+                    const int index = static_cast<int>(i);
+                    staged.push_back({ p.x, p.y, g, index });
+
+                    const float gx = p.x < margin ? p.x + torus.width : (p.x >= torus.width - margin ? p.x - torus.width : p.x);
+                    const float gy = p.y < margin ? p.y + torus.height : (p.y >= torus.height - margin ? p.y - torus.height : p.y);
+                    if (gx != p.x)
+                        staged.push_back({ gx, p.y, g, ~index });
+                    if (gy != p.y)
+                        staged.push_back({ p.x, gy, g, ~index });
+                    if (gx != p.x && gy != p.y)
+                        staged.push_back({ gx, gy, g, ~index });
+                }
+            }
+
+            size = cell_size;
+            inv_size = 1.0f / cell_size;
+            origin_x = -margin;
+            origin_y = -margin;
+            columns = static_cast<int>((torus.width + 2.0f * margin) * inv_size) + 1;
+            rows = static_cast<int>((torus.height + 2.0f * margin) * inv_size) + 1;
+            sortStaged();
+
+            steps_since_build = 0;
+            migrated_fraction = 1.0f;
+            rebuilt = true;
+        }
+
+        // Forces a full build on the next update(); the entries keep their capacity.
+        void invalidate()
+        {
+            entries.clear();
+            layout = GroupOffsets();
+        }
+
+        void build(const ParticleGroups& groups, float cell_size, float margin = 0.0f)
+        {
+            // Particles are not confined to the walls (they only reflect velocity),
+            // so the grid covers whatever the particles currently span.
+            float min_x, min_y, max_x, max_y;
+            extent(groups, min_x, min_y, max_x, max_y);
+            place(min_x - margin, min_y - margin, max_x + margin, max_y + margin, cell_size);
+            stage(groups);
+        }
+
+        // Same, but the grid covers no more than [x0, x1] x [y0, y1], and particles
+        // outside it clamp into the border cells. For culling a view, where an
+        // open world's escaped particles must not stretch the grid without bound.
+        void buildWithin(const ParticleGroups& groups, float cell_size, float x0, float y0, float x1, float y1)
+        {
+            float min_x, min_y, max_x, max_y;
+            extent(groups, min_x, min_y, max_x, max_y);
+            min_x = std::min(std::max(min_x, x0), x1); max_x = std::min(std::max(max_x, x0), x1);
+            min_y = std::min(std::max(min_y, y0), y1); max_y = std::min(std::max(max_y, y0), y1);
+            place(min_x, min_y, max_x, max_y, cell_size);
+            stage(groups);
+        }
+
+        int cellCount() const { return columns * rows; }
+        int cellIndex(int cx, int cy) const { return cy * columns + cx; }
+
+        // Positions outside the grid clamp to the border cells. Clamping never
+        // increases the cell distance between two points, so a search reach that
+        // covers the radius still finds every neighbour. The clamp is done in
+        // float, so a far-off position never overflows the conversion to int.
+        int cellX(float x) const { return static_cast<int>(std::min(std::max(0.0f, (x - origin_x) * inv_size), static_cast<float>(columns - 1))); }
+        int cellY(float y) const { return static_cast<int>(std::min(std::max(0.0f, (y - origin_y) * inv_size), static_cast<float>(rows - 1))); }
+
+        // Cells to search on each side to cover a radius.
+        int reach(float radius) const { return static_cast<int>(ceilf(radius * inv_size)); }
+
+        const GridEntry* cellBegin(int cell) const { return entries.data() + cell_start[cell]; }
+        const GridEntry* cellEnd(int cell) const { return entries.data() + cell_start[cell + 1]; }
+        std::size_t cellSize(int cell) const { return cell_start[cell + 1] - cell_start[cell]; }
+
+        float size = 1.0f;
+        float inv_size = 1.0f;
+        float origin_x = 0.0f;
+        float origin_y = 0.0f;
+        int columns = 0;
+        int rows = 0;
+
+    private:
+        static void extent(const ParticleGroups& groups, float& min_x, float& min_y, float& max_x, float& max_y)
+        {
+            min_x = min_y = max_x = max_y = 0.0f;
+            bool first = true;
+            for (const auto& group : groups)
+            {
+                for (const auto& p : group)
+                {
+                    if (first)
+                    {
+                        min_x = max_x = p.x;
+                        min_y = max_y = p.y;
+                        first = false;
+                    }
+                    min_x = std::min(min_x, p.x); max_x = std::max(max_x, p.x);
+                    min_y = std::min(min_y, p.y); max_y = std::max(max_y, p.y);
+                }
+            }
+        }
+
+        void place(float min_x, float min_y, float max_x, float max_y, float cell_size)
+        {
+            size = cell_size;
+            inv_size = 1.0f / cell_size;
+            origin_x = min_x;
+            origin_y = min_y;
+            columns = static_cast<int>((max_x - min_x) * inv_size) + 1;
+            rows = static_cast<int>((max_y - min_y) * inv_size) + 1;
+        }
+
+        void stage(const ParticleGroups& groups)
+        {
+            layout = GroupOffsets(groups);
+            staged.clear();
+            for (int g = 0; g < GroupCount; ++g)
+                for (std::size_t i = 0; i < groups[g].size(); ++i)
+                    staged.push_back({ groups[g][i].x, groups[g][i].y, g, static_cast<int>(i) });
+            sortStaged();
+        }
+
+        // Counting sort of staged into entries by cell.
+        void sortStaged()
+        {
+            cell_of.resize(staged.size());
+            reserveGrowing(cell_start, cellCount() + 1);
+            reserveGrowing(fill, cellCount());
+            cell_start.assign(cellCount() + 1, 0);
+            for (std::size_t k = 0; k < staged.size(); ++k)
+            {
+                cell_of[k] = cellIndex(cellX(staged[k].x), cellY(staged[k].y));
+                ++cell_start[cell_of[k] + 1];
+            }
+            for (int c = 0; c < cellCount(); ++c)
+                cell_start[c + 1] += cell_start[c];
+
+            entries.resize(staged.size());
+            fill.assign(cell_start.begin(), cell_start.end() - 1);
+            for (std::size_t k = 0; k < staged.size(); ++k)
+                entries[fill[cell_of[k]]++] = staged[k];
+        }
+
+        struct Migrant
+        {
+            int cell;       // destination
+            int entry;      // index into entries
+            bool operator<(const Migrant& other) const { return cell < other.cell || (cell == other.cell && entry < other.entry); }
+        };
+
+        // Incremental update: refresh every entry in place, then move only the
+        // ones that changed cell. The fix-up copies each cell's staying entries to
+        // its new start and appends its arrivals, one cell per task.
+        void relocate(const ParticleGroups& groups, ThreadPool& pool)
+        {
+            const int cells = cellCount();
+            leaving.assign(entries.size(), 0);
+            reserveGrowing(leave_count, cells);
+            leave_count.assign(cells, 0);
+            thread_migrants.resize(pool.size());
+            for (auto& list : thread_migrants)
+                list.clear();
+
+            pool.parallelFor(cells, 64, [&](std::size_t begin, std::size_t end, int thread_index)
+            {
+                for (std::size_t c = begin; c < end; ++c)
+                {
+                    for (int k = cell_start[c]; k < cell_start[c + 1]; ++k)
+                    {
+                        GridEntry& e = entries[k];
+                        const auto& p = groups[e.group][e.index];
+                        e.x = p.x;
+                        e.y = p.y;
+                        const int cell = cellIndex(cellX(p.x), cellY(p.y));
+                        if (cell != static_cast<int>(c))
+                        {
+                            leaving[k] = 1;
+                            ++leave_count[c];
+                            thread_migrants[thread_index].push_back({ cell, k });
+                        }
+                    }
+                }
+            });
+
+            migrants.clear();
+            for (const auto& list : thread_migrants)
+                migrants.insert(migrants.end(), list.begin(), list.end());
+            migrated_fraction = entries.empty() ? 0.0f : static_cast<float>(migrants.size()) / entries.size();
+            if (migrants.empty())
+                return;
+
+            std::sort(migrants.begin(), migrants.end());
+            reserveGrowing(arrival_start, cells + 1);
+            reserveGrowing(new_start, cells + 1);
+            arrival_start.assign(cells + 1, 0);
+            for (const Migrant& m : migrants)
+                ++arrival_start[m.cell + 1];
+            for (int c = 0; c < cells; ++c)
+                arrival_start[c + 1] += arrival_start[c];
+
+            new_start.resize(cells + 1);
+            new_start[0] = 0;
+            for (int c = 0; c < cells; ++c)
+                new_start[c + 1] = new_start[c] + (cell_start[c + 1] - cell_start[c]) - leave_count[c] + (arrival_start[c + 1] - arrival_start[c]);
+
+            relocated.resize(entries.size());
+            pool.parallelFor(cells, 64, [&](std::size_t begin, std::size_t end, int)
+            {
+                for (std::size_t c = begin; c < end; ++c)
+                {
+                    int out = new_start[c];
+                    for (int k = cell_start[c]; k < cell_start[c + 1]; ++k)
+                        if (!leaving[k])
+                            relocated[out++] = entries[k];
+                    for (int m = arrival_start[c]; m < arrival_start[c + 1]; ++m)
+                        relocated[out++] = entries[migrants[m].entry];
+                }
+            });
+
+            entries.swap(relocated);
+            cell_start.swap(new_start);
+        }
+
+        std::vector<int> cell_start;    // cellCount() + 1 prefix sums
+        std::vector<GridEntry> entries;
+        GroupOffsets layout;            // group sizes at the last build
+        int steps_since_build = 0;
+
+        std::vector<GridEntry> staged;  // build scratch
+        std::vector<int> cell_of;       // build scratch
+        std::vector<int> fill;          // build scratch
+
+        std::vector<std::uint8_t> leaving;                  // relocate scratch from here on
+        std::vector<int> leave_count;
+        std::vector<std::vector<Migrant>> thread_migrants;
+        std::vector<Migrant> migrants;
+        std::vector<int> arrival_start;
+        std::vector<int> new_start;
+        std::vector<GridEntry> relocated;
+    };
+}
+
+#endif // SPATIAL_GRID_H
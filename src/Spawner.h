@@ -0,0 +1,277 @@
+#ifndef SPAWNER_H
+#define SPAWNER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <math.h>
+#include "ParticleLife.h"
+#include "Random.h"
+#include "ThreadPool.h"
+
+namespace ParticleLife
+{
+    enum Distribution
+    {
+        Distribution_Uniform,       // same particles as addPoints() with the same Random
+        Distribution_PoissonDisk,   // uniform, but no two particles of the group closer than min_distance
+        Distribution_Clustered,     // discs around a few random centres
+        Distribution_Ring,          // annulus around the world centre
+        Distribution_COUNT
+    };
+
+    static const char* const DistributionNames[Distribution_COUNT] = { "Uniform", "Poisson disk", "Clustered", "Ring" };
+
+    // Bulk initial conditions. The group is resized once and filled in parallel
+    // ranges; particle k only reads draws of its own index from a counter-based
+    // Random, so the loops carry no dependency and the result is the same for
+    // any thread count. The ranges are the ones integration uses, so fresh
+    // pages are first touched by the thread that will keep updating them.
+    class Spawner
+    {
+    public:
+        int distribution = Distribution_Uniform;   // Distribution_
+        int clusters = 8;                           // Distribution_Clustered, at most MaxClusters
+        float cluster_radius = 40.0f;               // Distribution_Clustered
+        float ring_radius = 0.35f;                  // Distribution_Ring, fraction of the smaller world side
+        float ring_width = 0.05f;                   // Distribution_Ring, same
+        int attempts = 2;                           // Distribution_PoissonDisk, darts per grid cell
+
+        // Stats of the last spawn() with Distribution_PoissonDisk.
+        float min_distance = 0.0f;
+        std::size_t accepted = 0;                   // darts kept before thinning down to n
+
+        static const int MaxClusters = 64;
+
+        // Appends n particles to group.
+        void spawn(ParticleVector& group, int n, const WorldBounds& world, ImU32 color, const Random& rng, ThreadPool& pool)
+        {
+            const std::size_t first = group.size();
+            group.resize(first + n);
+            ParticleObject* out = group.data() + first;
+
+            switch (distribution)
+            {
+            case Distribution_PoissonDisk:
+                poissonDisk(group.data(), first, n, world, color, rng, pool);
+                break;
+            case Distribution_Clustered:
+                clustered(out, first, n, world, color, rng, pool);
+                break;
+            case Distribution_Ring:
+                ring(out, first, n, world, color, rng, pool);
+                break;
+            default:
+                pool.parallelRanges(n, [&](std::size_t begin, std::size_t end, int)
+                {
+                    for (std::size_t k = begin; k < end; ++k)
+                    {
+                        const std::uint64_t index = first + k;
+                        out[k] = { rng.uniformAt(2 * index) * world.width, rng.uniformAt(2 * index + 1) * world.height, 0.0f, 0.0f, color };
+                    }
+                });
+                break;
+            }
+        }
+
+        // Grows the group to n with fresh particles, or shrinks it by removing
+        // random ones so that no region empties first (a Poisson disk group is
+        // stored in cell order). A removal moves the last particle into the hole,
+        // so the group stays contiguous and every other particle keeps its index.
+        // rng picks the victims and places the newcomers; pass a stream not used
+        // for this group before, or newcomers repeat earlier particles' draws.
+        void resize(ParticleVector& group, int n, const WorldBounds& world, ImU32 color, Random& rng, ThreadPool& pool)
+        {
+            while (static_cast<int>(group.size()) > n)
+            {
+                const std::size_t victim = rng.next() % group.size();
+                group[victim] = group.back();
+                group.pop_back();
+            }
+            if (static_cast<int>(group.size()) < n)
+                spawn(group, n - static_cast<int>(group.size()), world, color, rng, pool);
+        }
+
+        // Replaces group g with counts[g] fresh particles drawn from stream g of
+        // seed. Clearing keeps each vector's allocation, so memory is only touched
+        // again when a count goes beyond its high-water mark.
+        void respawn(ParticleGroups& groups, const int counts[GroupCount], const ImU32 colors[GroupCount], const WorldBounds& world, std::uint64_t seed, ThreadPool& pool)
+        {
+            for (int g = 0; g < GroupCount; ++g)
+            {
+                groups[g].clear();
+                spawn(groups[g], counts[g], world, colors[g], Random(seed, g), pool);
+            }
+        }
+
+    private:
+        // Centres come from the top of the counter range, away from the particles' draws.
+        void clustered(ParticleObject* out, std::size_t first, int n, const WorldBounds& world, ImU32 color, const Random& rng, ThreadPool& pool)
+        {
+            const int count = std::min(std::max(clusters, 1), static_cast<int>(MaxClusters));
+            float centers[MaxClusters][2];
+            for (int c = 0; c < count; ++c)
+            {
+                const std::uint64_t k = ~static_cast<std::uint64_t>(0) - 2 * c;
+                centers[c][0] = cluster_radius + rng.uniformAt(k) * (world.width - 2.0f * cluster_radius);
+                centers[c][1] = cluster_radius + rng.uniformAt(k - 1) * (world.height - 2.0f * cluster_radius);
+            }
+
+            pool.parallelRanges(n, [&](std::size_t begin, std::size_t end, int)
+            {
+                for (std::size_t k = begin; k < end; ++k)
+                {
+                    const std::uint64_t index = 3 * (first + k);
+                    const float* center = centers[rng.at(index) % count];
+                    const float angle = 6.2831853f * rng.uniformAt(index + 1);
+                    const float r = cluster_radius * sqrtf(rng.uniformAt(index + 2));
+                    out[k] = { center[0] + r * cosf(angle), center[1] + r * sinf(angle), 0.0f, 0.0f, color };
+                }
+            });
+        }
+
+        void ring(ParticleObject* out, std::size_t first, int n, const WorldBounds& world, ImU32 color, const Random& rng, ThreadPool& pool)
+        {
+            const float side = std::min(world.width, world.height);
+            const float inner = side * (ring_radius - 0.5f * ring_width);
+            const float outer = side * (ring_radius + 0.5f * ring_width);
+            pool.parallelRanges(n, [&](std::size_t begin, std::size_t end, int)
+            {
+                for (std::size_t k = begin; k < end; ++k)
+                {
+                    const std::uint64_t index = 2 * (first + k);
+                    const float angle = 6.2831853f * rng.uniformAt(index);
+                    // Uniform in area between the two radii.
+                    const float r = sqrtf(inner * inner + rng.uniformAt(index + 1) * (outer * outer - inner * inner));
+                    out[k] = { 0.5f * world.width + r * cosf(angle), 0.5f * world.height + r * sinf(angle), 0.0f, 0.0f, color };
+                }
+            });
+        }
+
+        // Dart throwing on a background grid of cells min_distance / sqrt(2) wide,
+        // so a cell holds at most one sample and a dart only has to be checked
+        // against the 5 x 5 cells around it. Cells three apart cannot conflict, so
+        // the nine phases (cx % 3, cy % 3) each run in parallel. min_distance is set
+        // so that the darts comfortably exceed n; the surplus is thinned evenly in
+        // cell order, which keeps the spacing. Any shortfall is filled uniformly.
+        //
+        // The first `first` particles of the group are already placed (a group
+        // growing through resize()). They go into the background grid as well, in
+        // a cell list of their own since several can share a cell, and darts keep
+        // min_distance from them too. The spacing is then set for the whole group.
+        void poissonDisk(ParticleObject* group, std::size_t first, int n, const WorldBounds& world, ImU32 color, const Random& rng, ThreadPool& pool)
+        {
+            if (n <= 0)
+                return;
+
+            ParticleObject* out = group + first;
+            min_distance = 0.7f * sqrtf(world.width * world.height / (first + n));
+            const float size = min_distance / sqrtf(2.0f);
+            const int columns = static_cast<int>(ceilf(world.width / size));
+            const int rows = static_cast<int>(ceilf(world.height / size));
+            const float d2 = min_distance * min_distance;
+            samples.assign(static_cast<std::size_t>(columns) * rows, Sample{ 0.0f, 0.0f, false });
+            placeExisting(group, first, size, columns, rows);
+
+            for (int phase = 0; phase < 9; ++phase)
+            {
+                const int px = phase % 3, py = phase / 3;
+                const int phase_rows = (rows - py + 2) / 3;
+                pool.parallelFor(phase_rows, 4, [&](std::size_t begin, std::size_t end, int)
+                {
+                    for (std::size_t r = begin; r < end; ++r)
+                    {
+                        const int cy = py + 3 * static_cast<int>(r);
+                        for (int cx = px; cx < columns; cx += 3)
+                        {
+                            const std::uint64_t cell = static_cast<std::uint64_t>(cy) * columns + cx;
+                            for (int a = 0; a < attempts; ++a)
+                            {
+                                const std::uint64_t k = 2 * (cell * attempts + a);
+                                const float x = (cx + rng.uniformAt(k)) * size;
+                                const float y = (cy + rng.uniformAt(k + 1)) * size;
+                                if (x >= world.width || y >= world.height || !clear(x, y, cx, cy, columns, rows, d2))
+                                    continue;
+                                samples[cell] = { x, y, true };
+                                break;
+                            }
+                        }
+                    }
+                });
+            }
+
+            accepted = 0;
+            for (const Sample& s : samples)
+                accepted += s.taken;
+
+            // Keep sample m of the accepted ones when floor(m * n / accepted) steps.
+            std::size_t m = 0, written = 0;
+            for (const Sample& s : samples)
+            {
+                if (!s.taken)
+                    continue;
+                if (accepted <= static_cast<std::size_t>(n) || (m + 1) * n / accepted != m * n / accepted)
+                    out[written++] = { s.x, s.y, 0.0f, 0.0f, color };
+                ++m;
+            }
+            const std::uint64_t spare = 2 * static_cast<std::uint64_t>(samples.size()) * attempts;
+            for (std::size_t k = written; k < static_cast<std::size_t>(n); ++k)
+                out[k] = { rng.uniformAt(spare + 2 * k) * world.width, rng.uniformAt(spare + 2 * k + 1) * world.height, 0.0f, 0.0f, color };
+        }
+
+        // Counting sort of the particles already in the group into existing, by
+        // background cell. Particles outside the world clamp to the border cells.
+        void placeExisting(const ParticleObject* group, std::size_t count, float size, int columns, int rows)
+        {
+            existing_start.assign(static_cast<std::size_t>(columns) * rows + 1, 0);
+            existing_cell.resize(count);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const int cx = std::min(std::max(static_cast<int>(std::max(group[i].x, 0.0f) / size), 0), columns - 1);
+                const int cy = std::min(std::max(static_cast<int>(std::max(group[i].y, 0.0f) / size), 0), rows - 1);
+                existing_cell[i] = static_cast<std::size_t>(cy) * columns + cx;
+                ++existing_start[existing_cell[i] + 1];
+            }
+            for (std::size_t c = 1; c < existing_start.size(); ++c)
+                existing_start[c] += existing_start[c - 1];
+
+            existing.resize(count);
+            fill.assign(existing_start.begin(), existing_start.end() - 1);
+            for (std::size_t i = 0; i < count; ++i)
+                existing[fill[existing_cell[i]]++] = { group[i].x, group[i].y, true };
+        }
+
+        bool clear(float x, float y, int cx, int cy, int columns, int rows, float d2) const
+        {
+            for (int ny = std::max(cy - 2, 0); ny <= std::min(cy + 2, rows - 1); ++ny)
+            {
+                for (int nx = std::max(cx - 2, 0); nx <= std::min(cx + 2, columns - 1); ++nx)
+                {
+                    const std::size_t cell = static_cast<std::size_t>(ny) * columns + nx;
+                    const Sample& s = samples[cell];
+                    if (s.taken && (s.x - x) * (s.x - x) + (s.y - y) * (s.y - y) < d2)
+                        return false;
+                    for (std::size_t k = existing_start[cell]; k < existing_start[cell + 1]; ++k)
+                        if ((existing[k].x - x) * (existing[k].x - x) + (existing[k].y - y) * (existing[k].y - y) < d2)
+                            return false;
+                }
+            }
+            return true;
+        }
+
+        struct Sample
+        {
+            float x, y;
+            bool taken;
+        };
+
+        std::vector<Sample> samples;    // Distribution_PoissonDisk scratch from here on
+        std::vector<Sample> existing;   // particles already in the group, by cell
+        std::vector<std::size_t> existing_start;
+        std::vector<std::size_t> existing_cell;
+        std::vector<std::size_t> fill;
+    };
+}
+
+#endif // SPAWNER_H
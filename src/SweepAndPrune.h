@@ -0,0 +1,103 @@
+#ifndef SWEEP_AND_PRUNE_H
+#define SWEEP_AND_PRUNE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include "ParticleLife.h"
+#include "ThreadPool.h"
+
+namespace ParticleLife
+{
+    struct AxisEntry
+    {
+        float x;
+        float y;
+        int index;  // index within its group
+    };
+
+    // Each group kept sorted by x. Particles barely move between steps, so the
+    // previous order is almost sorted and an insertion sort fixes it in close to
+    // linear time. Neighbour candidates are then the x-window [x - r, x + r].
+    class SweepAndPrune
+    {
+    public:
+        // Insertion-sort moves in the last update(); a measure of how much the order changed.
+        std::size_t shifts = 0;
+
+        void update(const ParticleGroups& groups, ThreadPool& pool)
+        {
+            std::size_t group_shifts[GroupCount] = {};
+            pool.parallelFor(GroupCount, 1, [&](std::size_t begin, std::size_t end, int)
+            {
+                for (std::size_t g = begin; g < end; ++g)
+                    group_shifts[g] = sortGroup(groups[g], axes[g]);
+            });
+
+            shifts = 0;
+            for (int g = 0; g < GroupCount; ++g)
+                shifts += group_shifts[g];
+        }
+
+        const std::vector<AxisEntry>& sorted(int group) const { return axes[group]; }
+
+        // Forces a full sort on the next update() instead of an insertion sort of
+        // an order that no longer means anything.
+        void invalidate()
+        {
+            for (auto& axis : axes)
+                axis.clear();
+        }
+
+    private:
+        std::size_t sortGroup(const ParticleVector& group, std::vector<AxisEntry>& axis)
+        {
+            // A group resized by swap-removes and appends still holds every index
+            // below the smaller of the two sizes exactly once: drop the indices
+            // that are gone, append the new ones and let the insertion sort place
+            // them, unless so many changed that sorting afresh is cheaper.
+            const std::size_t changed = axis.size() > group.size() ? axis.size() - group.size() : group.size() - axis.size();
+            if (!axis.empty() && changed > 0 && changed * 8 < group.size())
+            {
+                const std::size_t old_size = axis.size();
+                axis.erase(std::remove_if(axis.begin(), axis.end(), [&](const AxisEntry& e) { return e.index >= static_cast<int>(group.size()); }), axis.end());
+                for (std::size_t i = old_size; i < group.size(); ++i)
+                    axis.push_back({ group[i].x, group[i].y, static_cast<int>(i) });
+            }
+
+            if (axis.size() != group.size())
+            {
+                axis.resize(group.size());
+                for (std::size_t i = 0; i < group.size(); ++i)
+                    axis[i] = { group[i].x, group[i].y, static_cast<int>(i) };
+                std::sort(axis.begin(), axis.end(), [](const AxisEntry& a, const AxisEntry& b) { return a.x < b.x; });
+                return group.size();
+            }
+
+            for (auto& e : axis)
+            {
+                e.x = group[e.index].x;
+                e.y = group[e.index].y;
+            }
+
+            std::size_t moves = 0;
+            for (std::size_t i = 1; i < axis.size(); ++i)
+            {
+                const AxisEntry e = axis[i];
+                std::size_t j = i;
+                while (j > 0 && axis[j - 1].x > e.x)
+                {
+                    axis[j] = axis[j - 1];
+                    --j;
+                }
+                axis[j] = e;
+                moves += i - j;
+            }
+            return moves;
+        }
+
+        std::vector<AxisEntry> axes[GroupCount];
+    };
+}
+
+#endif // SWEEP_AND_PRUNE_H
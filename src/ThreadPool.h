@@ -0,0 +1,220 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace ParticleLife
+{
+    enum Pinning
+    {
+        Pinning_None,       // threads float, as the OS schedules them
+        Pinning_Compact,    // thread t on CPU t: neighbours share caches, one socket fills up first
+        Pinning_Spread,     // threads spaced evenly over the CPU numbers, which spreads them over the sockets
+        Pinning_COUNT
+    };
+
+    static const char* const PinningNames[Pinning_COUNT] = { "None", "Compact", "Spread" };
+
+    // Fixed set of worker threads that run one job at a time. The calling thread
+    // takes part as thread 0, so a pool of size 1 spawns nothing.
+    class ThreadPool
+    {
+    public:
+        explicit ThreadPool(int thread_count)
+        {
+            thread_count = std::max(thread_count, 1);
+            busy_seconds.assign(thread_count, 0.0);
+            for (int i = 1; i < thread_count; ++i)
+                workers.emplace_back(&ThreadPool::workerLoop, this, i);
+        }
+
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (auto& worker : workers)
+                worker.join();
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        int size() const { return static_cast<int>(workers.size()) + 1; }
+
+        // Time each thread spent inside run() jobs since the last resetBusyTimes().
+        const std::vector<double>& busyTimes() const { return busy_seconds; }
+        void resetBusyTimes() { std::fill(busy_seconds.begin(), busy_seconds.end(), 0.0); }
+
+        // Runs fn(thread_index) once on every thread and returns when all are done.
+        // fn is called by reference through a plain function pointer, never copied
+        // into a std::function, so dispatching a job allocates nothing.
+        template <typename Fn>
+        void run(const Fn& fn)
+        {
+            const Job current = { &fn, [](const void* context, int thread_index) { (*static_cast<const Fn*>(context))(thread_index); } };
+            if (workers.empty())
+            {
+                timed(current, 0);
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                job = current;
+                pending = static_cast<int>(workers.size());
+                ++generation;
+            }
+            wake.notify_all();
+
+            timed(current, 0);
+
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [this] { return pending == 0; });
+            job = Job();
+        }
+
+        // Splits [0, count) into chunks handed out on demand, so threads that land
+        // on cheap chunks keep pulling work. Calls fn(begin, end, thread_index).
+        template <typename Fn>
+        void parallelFor(std::size_t count, std::size_t chunk, Fn fn)
+        {
+            if (count == 0)
+                return;
+
+            chunk = std::max<std::size_t>(chunk, 1);
+            std::atomic<std::size_t> next(0);
+            run([&](int thread_index)
+            {
+                for (;;)
+                {
+                    const std::size_t begin = next.fetch_add(chunk);
+                    if (begin >= count)
+                        break;
+                    fn(begin, std::min(begin + chunk, count), thread_index);
+                }
+            });
+        }
+
+        // Splits [0, count) into one contiguous range per thread, the same ranges
+        // for the same count every time, so each thread keeps working on the
+        // memory it touched first. For loops of even cost per element; calls
+        // fn(begin, end, thread_index).
+        template <typename Fn>
+        void parallelRanges(std::size_t count, Fn fn)
+        {
+            if (count == 0)
+                return;
+
+            const std::size_t threads = static_cast<std::size_t>(size());
+            run([&](int thread_index)
+            {
+                const std::size_t begin = count * thread_index / threads;
+                const std::size_t end = count * (thread_index + 1) / threads;
+                if (begin < end)
+                    fn(begin, end, thread_index);
+            });
+        }
+
+        // Pins every thread, the calling one as thread 0, to a CPU by Pinning_, or
+        // lets them all float again. Returns false if the platform has no
+        // affinity call (anything but Linux here) or a thread was refused.
+        bool pin(int mode)
+        {
+            pinning = mode;
+            const int cpus = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+            std::atomic<int> refused(0);
+            run([&](int thread_index)
+            {
+                int cpu = -1;
+                if (mode == Pinning_Compact)
+                    cpu = thread_index % cpus;
+                else if (mode == Pinning_Spread)
+                    cpu = static_cast<int>(static_cast<long long>(thread_index) * cpus / size());
+                if (!pinCurrentThread(cpu, cpus))
+                    ++refused;
+            });
+            return refused == 0;
+        }
+
+        int pinning = Pinning_None;     // last pin() mode
+
+    private:
+        // cpu < 0 allows every CPU.
+        static bool pinCurrentThread(int cpu, int cpus)
+        {
+#if defined(__linux__)
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (int c = 0; c < cpus && c < CPU_SETSIZE; ++c)
+                if (cpu < 0 || c == cpu)
+                    CPU_SET(c, &set);
+            return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+            (void)cpus;
+            return cpu < 0;
+#endif
+        }
+
+        struct Job
+        {
+            const void* context;
+            void (*invoke)(const void* context, int thread_index);
+        };
+
+        void timed(const Job& current, int thread_index)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            current.invoke(current.context, thread_index);
+            busy_seconds[thread_index] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        void workerLoop(int thread_index)
+        {
+            unsigned long long seen = 0;
+            for (;;)
+            {
+                Job current;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wake.wait(lock, [&] { return stopping || generation != seen; });
+                    if (stopping)
+                        return;
+                    seen = generation;
+                    current = job;
+                }
+
+                timed(current, thread_index);
+
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--pending == 0)
+                    done.notify_one();
+            }
+        }
+
+        std::vector<std::thread> workers;
+        std::vector<double> busy_seconds;   // slot t is only written by thread t
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+        Job job = Job();
+        unsigned long long generation = 0;
+        int pending = 0;
+        bool stopping = false;
+    };
+}
+
+#endif // THREAD_POOL_H
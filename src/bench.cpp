@@ -0,0 +1,970 @@
+// Headless benchmark and accuracy report for the simulation kernels.
+// Runs the default scene from main.cpp without a window so kernel variants
+// can be timed and compared against the reference rule().
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <vector>
+#define PARTICLE_LIFE_ALLOCATION_HOOKS
+#include "AllocationTracker.h"
+#include "Canvas.h"
+#include "ParticleObject.h"
+#include "ParticleLife.h"
+#include "Solver.h"
+#include "Spawner.h"
+
+using ParticleLife::ParticleGroups;
+using ParticleLife::Solver;
+
+struct Variant
+{
+    const char* name;
+    Solver solver;
+};
+
+static Solver makeSolver(int kernel, int law = ParticleLife::ForceLaw_Constant, int shape = ParticleLife::ForceShape_Constant)
+{
+    Solver solver;
+    solver.kernel = kernel;
+    solver.law = law;
+    solver.tables.shape = shape;
+    return solver;
+}
+
+static Solver makeBufferedSolver(int kernel, bool newton_pairs, int threads)
+{
+    Solver solver = makeSolver(kernel);
+    solver.integrator = ParticleLife::Integrator_Buffered;
+    solver.newton_pairs = newton_pairs;
+    solver.threads = threads;
+    return solver;
+}
+
+static Solver makeGridSolver(int threads, int balance)
+{
+    Solver solver = makeBufferedSolver(ParticleLife::Kernel_Fast, false, threads);
+    solver.spatial = ParticleLife::Spatial_Grid;
+    solver.balancer.mode = balance;
+    return solver;
+}
+
+static ParticleGroups makeScene(int per_group, unsigned int seed, const ParticleLife::WorldBounds& world = ParticleLife::WorldBounds())
+{
+    ParticleGroups groups;
+    ParticleLife::addPoints(groups[0], per_group, world.width, world.height, IM_COL32_WHITE, ParticleLife::Random(seed, 0));
+    ParticleLife::addPoints(groups[1], per_group, world.width, world.height, IM_COL32(0,0,255,255), ParticleLife::Random(seed, 1));
+    ParticleLife::addPoints(groups[2], per_group, world.width, world.height, IM_COL32(255,0,0,255), ParticleLife::Random(seed, 2));
+    ParticleLife::addPoints(groups[3], per_group, world.width, world.height, IM_COL32(0,255,0,255), ParticleLife::Random(seed, 3));
+    return groups;
+}
+
+// A settled-looking scene: every group packed into a few tight blobs, which is
+// where equal-area work splits fall apart.
+static ParticleGroups makeClusteredScene(int per_group, int clusters, unsigned int seed, const ParticleLife::WorldBounds& world = ParticleLife::WorldBounds())
+{
+    ParticleLife::Random rng(seed, ParticleLife::GroupCount);
+    clusters = std::max(clusters, 1);
+    std::vector<std::array<float, 2>> centers(clusters);
+    for (int c = 0; c < clusters; ++c)
+    {
+        centers[c][0] = 100.0f + rng.uniform(world.width - 200.0f);
+        centers[c][1] = 100.0f + rng.uniform(world.height - 200.0f);
+    }
+
+    const ParticleGroups uniform = makeScene(per_group, seed);
+    ParticleGroups groups = uniform;
+    for (auto& group : groups)
+    {
+        for (auto& p : group)
+        {
+            const std::array<float, 2>& center = centers[rng.next() % clusters];
+            const float angle = rng.uniform(6.2831853f);
+            const float r = 40.0f * sqrtf(rng.uniform());
+            p.x = center[0] + r * cosf(angle);
+            p.y = center[1] + r * sinf(angle);
+        }
+    }
+    return groups;
+}
+
+static double timeSteps(ParticleGroups groups, Solver solver, const ParticleLife::Params& params, int steps)
+{
+    // One untimed step so table builds and first-touch costs are not counted.
+    solver.step(groups, params);
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int s = 0; s < steps; ++s)
+        solver.step(groups, params);
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / steps;
+}
+
+struct ErrorStats
+{
+    double max_abs = 0.0;
+    double max_rel = 0.0;
+    double rms = 0.0;
+};
+
+// Compares velocities (one-step error) or positions (trajectory drift).
+static ErrorStats compare(const ParticleGroups& ref, const ParticleGroups& test, bool velocities)
+{
+    ErrorStats stats;
+    std::size_t n = 0;
+    for (int g = 0; g < ParticleLife::GroupCount; ++g)
+    {
+        for (std::size_t i = 0; i < ref[g].size(); ++i)
+        {
+            const ParticleObject& a = ref[g][i];
+            const ParticleObject& b = test[g][i];
+            const double ax = velocities ? a.vx : a.x, ay = velocities ? a.vy : a.y;
+            const double bx = velocities ? b.vx : b.x, by = velocities ? b.vy : b.y;
+            const double err = sqrt((ax - bx) * (ax - bx) + (ay - by) * (ay - by));
+            const double mag = sqrt(ax * ax + ay * ay);
+            stats.max_abs = err > stats.max_abs ? err : stats.max_abs;
+            if (mag > 1e-3)
+                stats.max_rel = err / mag > stats.max_rel ? err / mag : stats.max_rel;
+            stats.rms += err * err;
+            ++n;
+        }
+    }
+    stats.rms = n ? sqrt(stats.rms / n) : 0.0;
+    return stats;
+}
+
+static void accuracyReport(const Variant& ref_variant, const Variant& test_variant, const ParticleLife::Params& params, int per_group)
+{
+    printf("%s vs %s (%d particles per group)\n", test_variant.name, ref_variant.name, per_group);
+    Solver ref_solver = ref_variant.solver;
+    Solver test_solver = test_variant.solver;
+
+    // Warm up with the reference so velocities are non-trivial.
+    ParticleGroups start = makeScene(per_group, 1);
+    for (int s = 0; s < 50; ++s)
+        ref_solver.step(start, params);
+
+    ParticleGroups ref = start, test = start;
+    ref_solver.step(ref, params);
+    test_solver.step(test, params);
+    const ErrorStats one = compare(ref, test, true);
+    printf("  one step, velocity: max abs %.3e  max rel %.3e  rms %.3e\n", one.max_abs, one.max_rel, one.rms);
+
+    // The system is chaotic, so trajectories diverge regardless of kernel;
+    // this shows how quickly, not whether, they do.
+    const int drift_steps[] = { 10, 100 };
+    for (int steps : drift_steps)
+    {
+        ref = start;
+        test = start;
+        for (int s = 0; s < steps; ++s)
+        {
+            ref_solver.step(ref, params);
+            test_solver.step(test, params);
+        }
+        const ErrorStats drift = compare(ref, test, false);
+        printf("  %3d steps, position: max abs %.3e  rms %.3e\n", steps, drift.max_abs, drift.rms);
+    }
+}
+
+// Interpolation error of each tabulated profile against forceMagnitude(),
+// sampled between the table knots over the range the kernels look up.
+static void tableReport(const ParticleLife::Params& params)
+{
+    printf("Force table interpolation error (%d samples)\n", ParticleLife::ForceTable::Samples);
+    for (int shape = 0; shape < ParticleLife::ForceShape_COUNT; ++shape)
+    {
+        ParticleLife::ForceTables tables;
+        tables.shape = shape;
+        tables.update(params);
+
+        double max_rel = 0.0, sum_rel = 0.0;
+        int n = 0;
+        for (int i = 0; i < ParticleLife::GroupCount; ++i)
+        {
+            for (int j = 0; j < ParticleLife::GroupCount; ++j)
+            {
+                const ParticleLife::ForceTable& table = tables.tables[i][j];
+                const float g = params.forces[i][j];
+                double peak = 0.0;
+                for (float v : table.values)
+                    peak = fabs(v) > peak ? fabs(v) : peak;
+                if (peak == 0.0)
+                    continue;
+                for (int k = 1; k < 4000; ++k)
+                {
+                    const float d2 = table.min_d2 + (table.max_d2 - table.min_d2) * k / 4000.0f;
+                    const double exact = ParticleLife::forceMagnitude(static_cast<ParticleLife::ForceShape>(shape), g, sqrtf(d2), params.radius[i], tables.core);
+                    // Relative to the profile's peak so zero crossings do not dominate.
+                    const double rel = fabs(table.lookup(d2) - exact) / peak;
+                    max_rel = rel > max_rel ? rel : max_rel;
+                    sum_rel += rel;
+                    ++n;
+                }
+            }
+        }
+        printf("  %-16s max %.3e  mean %.3e (relative to peak)\n", ParticleLife::ForceShapeNames[shape], max_rel, sum_rel / n);
+    }
+}
+
+// Per-thread busy time of the grid integrator on a clustered scene for each balance mode.
+static void balanceReport(const ParticleLife::Params& params, int per_group, int steps, int threads)
+{
+    printf("Load balance, clustered scene (%d particles per group, %d threads)\n", per_group, threads);
+    const ParticleGroups scene = makeClusteredScene(per_group, 5, 7);
+    for (int mode = 0; mode < ParticleLife::Balance_COUNT; ++mode)
+    {
+        Solver solver = makeGridSolver(threads, mode);
+        ParticleGroups groups = scene;
+        solver.step(groups, params);    // seeds the measured costs
+
+        std::vector<double> busy(threads, 0.0);
+        const auto start = std::chrono::steady_clock::now();
+        for (int s = 0; s < steps; ++s)
+        {
+            solver.step(groups, params);
+            for (int t = 0; t < threads; ++t)
+                busy[t] += solver.thread_busy_ms[t];
+        }
+        const double wall = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / steps;
+
+        double busiest = 0.0, total = 0.0;
+        for (double ms : busy)
+        {
+            busiest = ms > busiest ? ms : busiest;
+            total += ms;
+        }
+        printf("  %-14s %8.3f ms/step  busy max/mean %.2f  [", ParticleLife::BalanceNames[mode], wall, total > 0.0 ? busiest * threads / total : 1.0);
+        for (int t = 0; t < threads; ++t)
+            printf(t ? " %.1f" : "%.1f", busy[t] / steps);
+        printf("] ms\n");
+    }
+}
+
+// Maintenance and force cost of the uniform grid, quadtree and sweep and prune, stepping
+// the buffered integrator directly so both phases can be timed separately.
+static void spatialReport(const ParticleLife::Params& params, int per_group, int steps, int threads)
+{
+    printf("Spatial index cost (%d particles per group, %d threads)\n", per_group, threads);
+    ParticleLife::ThreadPool pool(threads);
+    const ParticleLife::LawSettings settings;
+    const auto make_law = [&](int i, int j) { return ParticleLife::ConstantLaw(params.forces[i][j], params.radius[i], settings); };
+    const ParticleLife::Walls walls((ParticleLife::WorldBounds()));
+    float cell_size = params.radius[0];
+    for (int g = 1; g < ParticleLife::GroupCount; ++g)
+        cell_size = params.radius[g] < cell_size ? params.radius[g] : cell_size;
+
+    const char* scene_names[] = { "uniform", "clustered" };
+    for (int scene_index = 0; scene_index < 2; ++scene_index)
+    {
+        const ParticleGroups scene = scene_index == 0 ? makeScene(per_group, 1) : makeClusteredScene(per_group, 5, 7);
+        const double particles = 4.0 * per_group;
+
+        const char* index_names[] = { "grid", "grid (incr.)", "quadtree", "sweep" };
+        for (int index = 0; index < 4; ++index)
+        {
+            ParticleGroups groups = scene;
+            ParticleLife::UniformGrid grid;
+            grid.incremental = index == 1;
+            ParticleLife::QuadTree tree;
+            ParticleLife::SweepAndPrune sweep;
+            ParticleLife::LoadBalancer balancer;
+            ParticleLife::ForceBuffer forces;
+            double maintain_ms = 0.0, force_ms = 0.0, pairs = 0.0, migrated = 0.0, shifts = 0.0;
+
+            for (int s = 0; s < steps; ++s)
+            {
+                const auto t0 = std::chrono::steady_clock::now();
+                if (index < 2)
+                    grid.update(groups, cell_size, pool);
+                else if (index == 2)
+                    tree.update(groups);
+                else
+                    sweep.update(groups, pool);
+                const auto t1 = std::chrono::steady_clock::now();
+                if (index < 2)
+                {
+                    ParticleLife::accumulateGridForces(groups, grid, make_law, pool, balancer, forces);
+                    pairs += balancer.totalCost();
+                    migrated += s > 0 ? grid.migrated_fraction * particles : 0.0;
+                }
+                else if (index == 2)
+                {
+                    pairs += ParticleLife::accumulateTreeForces(groups, tree, make_law, walls, pool, forces);
+                    migrated += s > 0 ? tree.migrated : 0;
+                }
+                else
+                {
+                    pairs += ParticleLife::accumulateSweepForces(groups, sweep, make_law, walls, pool, forces);
+                    shifts += s > 0 ? sweep.shifts : 0;
+                }
+                const auto t2 = std::chrono::steady_clock::now();
+                ParticleLife::integrateAll(groups, forces, walls, ParticleLife::TimeStep(), pool);
+
+                maintain_ms += std::chrono::duration<double, std::milli>(t1 - t0).count();
+                force_ms += std::chrono::duration<double, std::milli>(t2 - t1).count();
+            }
+
+            printf("  %-9s %-12s maintain %7.3f ms  forces %8.3f ms  pairs/particle %7.1f",
+                scene_names[scene_index], index_names[index], maintain_ms / steps, force_ms / steps, pairs / steps / particles);
+            if (index == 1 || index == 2)
+                printf("  migrated %.1f%%", steps > 1 ? 100.0 * migrated / (steps - 1) / particles : 0.0);
+            if (index == 2)
+                printf("  leaves %zu", tree.leaves().size());
+            if (index == 3)
+                printf("  sort moves/particle %.2f", steps > 1 ? shifts / (steps - 1) / particles : 0.0);
+            printf("\n");
+        }
+    }
+}
+
+// Grid integrator on worlds scaled up at constant density: ideally the cost per
+// particle stays flat as the world and the particle count grow together.
+static void scalingReport(const ParticleLife::Params& params, int per_group, int steps, int threads)
+{
+    printf("Scaling at constant density (%d threads)\n", threads);
+    const float factors[] = { 1.0f, 4.0f, 16.0f };
+    for (float factor : factors)
+    {
+        Solver solver = makeGridSolver(threads, ParticleLife::Balance_MeasuredCost);
+        solver.world = solver.world.scaled(factor);
+        const int n = static_cast<int>(per_group * factor);
+        const ParticleGroups groups = makeScene(n, 1, solver.world);
+        const double ms = timeSteps(groups, solver, params, steps);
+        printf("  %5.0f x %5.0f  %7d particles  %9.3f ms/step  %7.3f us/particle\n",
+            solver.world.width, solver.world.height, 4 * n, ms, 1000.0 * ms / (4.0 * n));
+    }
+}
+
+// One ParticleStore layout through the unified-store step, phase by phase.
+// Returns the groups after the last step.
+template <typename Layout>
+static ParticleGroups layoutRun(const ParticleGroups& scene, const ParticleLife::Params& params, int steps, ParticleLife::ThreadPool& pool, float cell_size, bool quantise = false)
+{
+    const ParticleLife::LawSettings settings;
+    const auto make_law = [&](int i, int j) { return ParticleLife::ConstantLaw(params.forces[i][j], params.radius[i], settings); };
+    const ParticleLife::Walls walls((ParticleLife::WorldBounds()));
+    ParticleGroups groups = scene;
+    ParticleLife::ParticleStore<Layout> store;
+    store.quantise = quantise;
+    ParticleLife::LoadBalancer balancer;
+    double load_ms = 0.0, force_ms = 0.0, integrate_ms = 0.0, scatter_ms = 0.0;
+
+    for (int s = 0; s < steps; ++s)
+    {
+        const auto t0 = std::chrono::steady_clock::now();
+        store.load(groups, cell_size, pool);
+        const auto t1 = std::chrono::steady_clock::now();
+        ParticleLife::accumulateStoreForces(store, make_law, pool, balancer);
+        const auto t2 = std::chrono::steady_clock::now();
+        ParticleLife::integrateStore(store, walls, ParticleLife::TimeStep(), pool);
+        const auto t3 = std::chrono::steady_clock::now();
+        store.scatter(groups, pool);
+        const auto t4 = std::chrono::steady_clock::now();
+
+        load_ms += std::chrono::duration<double, std::milli>(t1 - t0).count();
+        force_ms += std::chrono::duration<double, std::milli>(t2 - t1).count();
+        integrate_ms += std::chrono::duration<double, std::milli>(t3 - t2).count();
+        scatter_ms += std::chrono::duration<double, std::milli>(t4 - t3).count();
+    }
+
+    char label[32];
+    snprintf(label, sizeof(label), "%s%s", Layout::name(), quantise ? " 16-bit" : "");
+    printf("  %-12s load %7.3f ms  forces %8.3f ms  integrate %6.3f ms  scatter %6.3f ms  total %8.3f ms",
+        label, load_ms / steps, force_ms / steps, integrate_ms / steps, scatter_ms / steps,
+        (load_ms + force_ms + integrate_ms + scatter_ms) / steps);
+    return groups;
+}
+
+// Every ParticleStore layout on the same scenes and steps. They run the same
+// loop in the same order, so the trajectories must match bit for bit. The grid
+// solver on the groups themselves comes first: a store only pays off end to
+// end once its forces beat that by more than its load and scatter cost.
+static void layoutReport(const ParticleLife::Params& params, int per_group, int steps, int threads)
+{
+    printf("Store layouts (%d particles per group, %d threads)\n", per_group, threads);
+    ParticleLife::ThreadPool pool(threads);
+    float cell_size = params.radius[0];
+    for (int g = 1; g < ParticleLife::GroupCount; ++g)
+        cell_size = params.radius[g] < cell_size ? params.radius[g] : cell_size;
+
+    const char* scene_names[] = { "uniform", "clustered" };
+    for (int scene_index = 0; scene_index < 2; ++scene_index)
+    {
+        const ParticleGroups scene = scene_index == 0 ? makeScene(per_group, 1) : makeClusteredScene(per_group, 5, 7);
+        printf(" %s\n", scene_names[scene_index]);
+        printf("  %-12s %73s total %8.3f ms\n", "Groups", "", timeSteps(scene, makeGridSolver(threads, ParticleLife::Balance_MeasuredCost), params, steps));
+        const ParticleGroups soa = layoutRun<ParticleLife::LayoutSoA>(scene, params, steps, pool, cell_size);
+        printf("\n");
+        const ParticleGroups aos = layoutRun<ParticleLife::LayoutAoS>(scene, params, steps, pool, cell_size);
+        printf("  drift vs SoA %g\n", compare(soa, aos, false).max_abs);
+        const ParticleGroups aosoa8 = layoutRun<ParticleLife::LayoutAoSoA<8>>(scene, params, steps, pool, cell_size);
+        printf("  drift vs SoA %g\n", compare(soa, aosoa8, false).max_abs);
+        const ParticleGroups aosoa16 = layoutRun<ParticleLife::LayoutAoSoA<16>>(scene, params, steps, pool, cell_size);
+        printf("  drift vs SoA %g\n", compare(soa, aosoa16, false).max_abs);
+        const ParticleGroups hot_cold = layoutRun<ParticleLife::LayoutHotCold>(scene, params, steps, pool, cell_size);
+        printf("  drift vs SoA %g\n", compare(soa, hot_cold, false).max_abs);
+        const ParticleGroups quantised = layoutRun<ParticleLife::LayoutSoA>(scene, params, steps, pool, cell_size, true);
+        printf("  drift vs SoA %g\n", compare(soa, quantised, false).max_abs);
+    }
+}
+
+// Dense against hashed grid on a huge open world with a few small clusters,
+// where almost every cell of the dense grid is empty.
+static void sparseReport(const ParticleLife::Params& params, int per_group, int steps, int threads)
+{
+    ParticleLife::WorldBounds world;
+    world.width = world.height = 50000.0f;
+    world.boundary = ParticleLife::Boundary_Open;
+    printf("Sparse open world %.0f x %.0f (%d particles per group, %d threads)\n", world.width, world.height, per_group, threads);
+    const ParticleGroups scene = makeClusteredScene(per_group, 8, 3, world);
+
+    const int modes[] = { ParticleLife::Spatial_Grid, ParticleLife::Spatial_HashGrid };
+    for (int mode : modes)
+    {
+        Solver solver = makeGridSolver(threads, ParticleLife::Balance_MeasuredCost);
+        solver.spatial = mode;
+        solver.world = world;
+        ParticleGroups groups = scene;
+        solver.step(groups, params);
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int s = 0; s < steps; ++s)
+            solver.step(groups, params);
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / steps;
+        if (mode == ParticleLife::Spatial_Grid)
+            printf("  %-14s %9.3f ms/step  cells %d\n", ParticleLife::SpatialNames[mode], ms, solver.grid.cellCount());
+        else
+            printf("  %-14s %9.3f ms/step  cells %d, table slots %zu\n", ParticleLife::SpatialNames[mode], ms, solver.hash.cellCount(), solver.hash.capacity());
+    }
+}
+
+// Sub-stepping against a much finer step over the same simulated time. The
+// error should fall roughly in proportion to dt / substeps (first order).
+static void substepReport(const ParticleLife::Params& params, int per_group, int threads)
+{
+    const int steps = 10;
+    printf("Substeps vs 32 substeps over %d steps of dt 1 (%d particles per group)\n", steps, per_group);
+    Solver solver = makeGridSolver(threads, ParticleLife::Balance_MeasuredCost);
+    ParticleGroups start = makeScene(per_group, 1);
+    for (int s = 0; s < 50; ++s)
+        solver.step(start, params);
+
+    ParticleGroups fine = start;
+    solver.substeps = 32;
+    for (int s = 0; s < steps; ++s)
+        solver.step(fine, params);
+
+    const int counts[] = { 1, 2, 4, 8 };
+    for (int substeps : counts)
+    {
+        ParticleGroups coarse = start;
+        solver.substeps = substeps;
+        for (int s = 0; s < steps; ++s)
+            solver.step(coarse, params);
+        const ErrorStats drift = compare(fine, coarse, false);
+        printf("  %2d substeps, position: max abs %.3e  rms %.3e\n", substeps, drift.max_abs, drift.rms);
+    }
+}
+
+// Adaptive against fixed dt = 1 from the random start: the adaptive step is
+// small while the initial forces are large and grows as clusters settle, so
+// it covers more simulated time per wall-clock second.
+static void adaptiveReport(const char* name, const ParticleLife::Params& params, int per_group, int threads)
+{
+    printf("Adaptive time step from random start, %s (%d particles per group, %d threads)\n", name, per_group, threads);
+    Solver fixed = makeGridSolver(threads, ParticleLife::Balance_MeasuredCost);
+    Solver adaptive = fixed;
+    adaptive.adaptive = true;
+    ParticleGroups fixed_groups = makeScene(per_group, 1), adaptive_groups = fixed_groups;
+
+    double fixed_ms = 0.0, adaptive_ms = 0.0;
+    const int checkpoints[] = { 10, 50, 200, 1000 };
+    int done = 0;
+    for (int steps : checkpoints)
+    {
+        for (; done < steps; ++done)
+        {
+            auto start = std::chrono::steady_clock::now();
+            fixed.step(fixed_groups, params);
+            fixed_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            start = std::chrono::steady_clock::now();
+            adaptive.step(adaptive_groups, params);
+            adaptive_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        printf("  %4d steps: dt %6.3f  max speed %7.3f  max force %7.3f  simulated %7.1f vs %7.1f fixed\n",
+            steps, adaptive.last_dt, adaptive.motion.max_speed, adaptive.motion.max_force, adaptive.simulated_time, fixed.simulated_time);
+    }
+    printf("  simulated time per wall second: adaptive %.0f, fixed %.0f\n",
+        1000.0 * adaptive.simulated_time / adaptive_ms, 1000.0 * fixed.simulated_time / fixed_ms);
+}
+
+// Every variant stepped from the same seed with 1 thread and with more; any
+// difference at all shows up as mismatching bits.
+static void determinismReport(const Variant* const* variants, int count, const ParticleLife::Params& params, int per_group, int threads)
+{
+    const int steps = 20;
+    printf("Bitwise against 1 thread after %d steps (%d particles per group)\n", steps, per_group);
+    const ParticleGroups scene = makeScene(per_group, 7);
+    for (int v = 0; v < count; ++v)
+    {
+        Solver single = variants[v]->solver;
+        single.threads = 1;
+        ParticleGroups expected = scene;
+        for (int s = 0; s < steps; ++s)
+            single.step(expected, params);
+
+        printf("  %-24s", variants[v]->name);
+        const int thread_counts[] = { 2, 3, threads };
+        for (int t : thread_counts)
+        {
+            Solver multi = variants[v]->solver;
+            multi.threads = t;
+            ParticleGroups groups = scene;
+            for (int s = 0; s < steps; ++s)
+                multi.step(groups, params);
+
+            std::size_t differ = 0;
+            for (int g = 0; g < ParticleLife::GroupCount; ++g)
+                for (std::size_t i = 0; i < groups[g].size(); ++i)
+                    differ += memcmp(&groups[g][i], &expected[g][i], sizeof(ParticleObject)) != 0;
+            printf("  %2d threads: %s", t, differ ? "differ" : "same  ");
+            if (differ)
+                printf(" (%zu)", differ);
+        }
+        printf("\n");
+    }
+}
+
+// Time to fill one group of a million particles with each distribution, against
+// addPoints(). The Poisson disk spacing is checked by brute force on a small group.
+static void spawnReport(int threads)
+{
+    const int n = 1000000;
+    const ParticleLife::WorldBounds world = ParticleLife::WorldBounds().scaled(30.0f);
+    printf("Spawning %d particles in %.0f x %.0f\n", n, world.width, world.height);
+    const ParticleLife::Random rng(5);
+
+    ParticleLife::ParticleVector group;
+    auto start = std::chrono::steady_clock::now();
+    ParticleLife::addPoints(group, n, world.width, world.height, IM_COL32_WHITE, rng);
+    printf("  %-14s %8.2f ms\n", "addPoints", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    const ParticleLife::ParticleVector reference = group;
+
+    const int thread_counts[] = { 1, threads };
+    for (int t : thread_counts)
+    {
+        ParticleLife::ThreadPool pool(t);
+        for (int d = 0; d < ParticleLife::Distribution_COUNT; ++d)
+        {
+            ParticleLife::Spawner spawner;
+            spawner.distribution = d;
+            group.clear();
+            start = std::chrono::steady_clock::now();
+            spawner.spawn(group, n, world, IM_COL32_WHITE, rng, pool);
+            printf("  %-14s %8.2f ms  %d threads", ParticleLife::DistributionNames[d], std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(), t);
+            if (d == ParticleLife::Distribution_Uniform)
+                printf("%s", memcmp(group.data(), reference.data(), n * sizeof(ParticleObject)) == 0 ? ", same as addPoints" : ", differs from addPoints");
+            if (d == ParticleLife::Distribution_PoissonDisk)
+                printf(", min distance %.2f, %zu darts kept", spawner.min_distance, spawner.accepted);
+            printf("\n");
+        }
+    }
+
+    ParticleLife::ThreadPool pool(threads);
+    ParticleLife::Spawner spawner;
+    spawner.distribution = ParticleLife::Distribution_PoissonDisk;
+    const auto closestPair = [&]()
+    {
+        float closest = 1e30f;
+        for (std::size_t i = 0; i < group.size(); ++i)
+            for (std::size_t j = i + 1; j < group.size(); ++j)
+                closest = std::min(closest, sqrtf((group[i].x - group[j].x) * (group[i].x - group[j].x) + (group[i].y - group[j].y) * (group[i].y - group[j].y)));
+        return closest;
+    };
+    group.clear();
+    spawner.spawn(group, 2000, ParticleLife::WorldBounds(), IM_COL32_WHITE, rng, pool);
+    printf("  Poisson disk, 2000 particles: closest pair %.2f, min distance %.2f\n", closestPair(), spawner.min_distance);
+
+    // Growing a group: the newcomers keep their distance from the particles already there.
+    group.clear();
+    spawner.spawn(group, 1000, ParticleLife::WorldBounds(), IM_COL32_WHITE, rng, pool);
+    ParticleLife::Random grow_rng(2, 0);
+    spawner.resize(group, 2000, ParticleLife::WorldBounds(), IM_COL32_WHITE, grow_rng, pool);
+    printf("  Poisson disk, 1000 grown to 2000: closest pair %.2f, min distance %.2f, %zu darts kept\n", closestPair(), spawner.min_distance, spawner.accepted);
+
+    // Respawning into the groups of the last run against filling new ones.
+    const int counts[ParticleLife::GroupCount] = { n / 4, n / 4, n / 4, n / 4 };
+    const ImU32 colors[ParticleLife::GroupCount] = { IM_COL32_WHITE, IM_COL32(0,0,255,255), IM_COL32(255,0,0,255), IM_COL32(0,255,0,255) };
+    spawner.distribution = ParticleLife::Distribution_Uniform;
+    ParticleGroups groups;
+    spawner.respawn(groups, counts, colors, world, 1, pool);
+    const ParticleObject* before = groups[0].data();
+    start = std::chrono::steady_clock::now();
+    for (int seed = 2; seed < 12; ++seed)
+        spawner.respawn(groups, counts, colors, world, seed, pool);
+    const double in_place = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / 10;
+    start = std::chrono::steady_clock::now();
+    for (int seed = 2; seed < 12; ++seed)
+    {
+        ParticleGroups fresh;
+        spawner.respawn(fresh, counts, colors, world, seed, pool);
+    }
+    const double fresh = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / 10;
+    printf("  respawn %d in place %.2f ms%s, into new groups %.2f ms\n", n, in_place, groups[0].data() == before ? " (no reallocation)" : "", fresh);
+
+    // Counts dragged up and down: after the first swing the groups only trade
+    // blocks through the pool.
+    const ParticleLife::BlockPool& blocks = ParticleLife::BlockPool::instance();
+    const std::size_t heap_before = blocks.heap_allocations;
+    int batch = 0;
+    start = std::chrono::steady_clock::now();
+    for (int swing = 0; swing < 20; ++swing)
+    {
+        for (int g = 0; g < ParticleLife::GroupCount; ++g)
+        {
+            ParticleLife::Random rng(1, g + ParticleLife::GroupCount * ++batch);
+            const int count = swing % 2 ? counts[g] / (g + 1) : counts[g] * (g + 1);
+            spawner.resize(groups[g], count, world, colors[g], rng, pool);
+        }
+    }
+    printf("  20 count swings %.2f ms, %zu heap allocations\n", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(),
+        blocks.heap_allocations - heap_before);
+}
+
+// Heap allocations per step once warm, as counted by the AllocationTracker:
+// operator new, hooked in this file, and blocks the BlockPool takes from the
+// heap. A variant that allocates in any step after the warm-up fails, and the
+// benchmark then exits with status 1.
+static bool allocationReport(const Variant* const* variants, int count, const ParticleLife::Params& params, int per_group, int steps)
+{
+    const int warmup = 200;
+    printf("Heap allocations per step (%d particles per group, %d steps after %d warm-up steps)\n", per_group, steps, warmup);
+    const ParticleLife::AllocationTracker& tracker = ParticleLife::AllocationTracker::instance();
+    const ParticleGroups scene = makeScene(per_group, 1);
+    bool clean = true;
+    for (int v = 0; v < count; ++v)
+    {
+        ParticleGroups groups = scene;
+        Solver solver = variants[v]->solver;
+        for (int s = 0; s < warmup; ++s)
+            solver.step(groups, params);
+
+        const ParticleLife::AllocationTracker::Counts start = tracker.counts();
+        int allocating = 0;
+        for (int s = 0; s < steps; ++s)
+        {
+            const ParticleLife::AllocationTracker::Counts before = tracker.counts();
+            solver.step(groups, params);
+            allocating += tracker.since(before).allocations > 0;
+        }
+        const ParticleLife::AllocationTracker::Counts total = tracker.since(start);
+        printf("  %-22s %zu allocations, %zu bytes, in %d of %d steps%s\n", variants[v]->name, total.allocations, total.bytes, allocating, steps,
+            allocating > 0 ? "  FAIL" : "");
+        clean = clean && allocating == 0;
+    }
+    printf("  scratch high-water %zu bytes\n", ParticleLife::FrameArena::instance().high_water);
+    return clean;
+}
+
+// Heap allocations per frame of the app's loop without a window: the steps, an
+// ImGui frame with the canvas drawn into it, and Render(). ImGui allocates
+// through the tracker, as in main.cpp. The canvas is drawn fitted through the
+// solver's grid, zoomed in through its own and zoomed out as a density map,
+// each warmed up before it is counted; any allocating frame fails.
+static bool frameAllocationReport(const Solver& grid_solver, const ParticleLife::Params& params, int per_group, int frames)
+{
+    const int warmup = 200;
+    const float width = 1200.0f, height = 900.0f;
+    printf("Heap allocations per frame (%d particles per group, %d frames after %d warm-up frames)\n", per_group, frames, warmup);
+    const ParticleLife::AllocationTracker& tracker = ParticleLife::AllocationTracker::instance();
+
+    ImGui::SetAllocatorFunctions(ParticleLife::AllocationTracker::imguiAlloc, ParticleLife::AllocationTracker::imguiFree);
+    ImGuiContext* context = ImGui::CreateContext();
+    ImGuiIO& io = ImGui::GetIO();
+    io.IniFilename = NULL;      // the settings save allocates, and a bench has none to keep
+    io.DisplaySize = ImVec2(width, height);
+    io.DeltaTime = 1.0f / 60.0f;
+    unsigned char* pixels = NULL;
+    int atlas_w = 0, atlas_h = 0;
+    io.Fonts->GetTexDataAsRGBA32(&pixels, &atlas_w, &atlas_h);
+
+    const ParticleLife::WorldBounds world;
+    ParticleGroups groups = makeScene(per_group, 1, world);
+    Solver solver = grid_solver;
+    ParticleLife::CanvasRenderer renderer;
+    const char* view_names[] = { "fitted, solver grid", "zoomed in, own grid", "density map" };
+    const float zooms[] = { 0.0f, 4.0f, 0.1f };
+    bool clean = true;
+    for (int view = 0; view < 3; ++view)
+    {
+        ParticleLife::Camera camera;
+        camera.fit(world, width, height);
+        if (zooms[view] > 0.0f)
+            camera.zoomAt(0.5f * width, 0.5f * height, zooms[view] / camera.zoom);
+
+        ParticleLife::AllocationTracker::Counts start = tracker.counts();
+        int allocating = 0;
+        for (int f = 0; f < warmup + frames; ++f)
+        {
+            if (f == warmup)
+                start = tracker.counts();
+            const ParticleLife::AllocationTracker::Counts before = tracker.counts();
+
+            ImGui::NewFrame();
+            solver.step(groups, params);
+            ImGui::SetNextWindowPos(ImVec2(0.0f, 0.0f));
+            ImGui::SetNextWindowSize(ImVec2(width, height));
+            ImGui::Begin("Canvas", NULL, ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoMove);
+            ImGui::Text("Zoom %.3f, drawn %d of %d visited", camera.zoom, static_cast<int>(renderer.drawn), static_cast<int>(renderer.visited));
+            renderer.draw(ImGui::GetWindowDrawList(), ImGui::GetWindowPos(), ImVec2(width, height), camera, world, groups, view == 0 ? &solver.grid : nullptr);
+            ImGui::End();
+            ImGui::Render();
+
+            if (f >= warmup)
+                allocating += tracker.since(before).allocations > 0;
+        }
+        const ParticleLife::AllocationTracker::Counts total = tracker.since(start);
+        printf("  %-22s %zu allocations, %zu bytes, in %d of %d frames, %zu drawn%s\n", view_names[view], total.allocations, total.bytes, allocating, frames,
+            renderer.drawn, allocating > 0 ? "  FAIL" : "");
+        clean = clean && allocating == 0;
+    }
+
+    ImGui::DestroyContext(context);
+    return clean;
+}
+
+// Transparent huge pages backing this process, or -1 where the kernel does not say.
+static long anonHugePagesKB()
+{
+    FILE* file = fopen("/proc/self/smaps_rollup", "r");
+    if (!file)
+        return -1;
+    long kb = -1;
+    char line[256];
+    while (fgets(line, sizeof(line), file))
+        if (sscanf(line, "AnonHugePages: %ld kB", &kb) == 1)
+            break;
+    fclose(file);
+    return kb;
+}
+
+// The memory-bound phases at scale, where page size and placement matter rather
+// than arithmetic: respawning (the first touch), integrating the groups, and
+// loading, integrating and scattering a unified store. Forces stay zero.
+static void memoryReport(int per_group, int steps, int threads)
+{
+    const int n = per_group * 256;
+    const ParticleLife::WorldBounds world = ParticleLife::WorldBounds().scaled(256.0f);
+    printf("Memory placement (%d particles, %d threads)\n", 4 * n, threads);
+    const int counts[ParticleLife::GroupCount] = { n, n, n, n };
+    const ImU32 colors[ParticleLife::GroupCount] = { IM_COL32_WHITE, IM_COL32(0,0,255,255), IM_COL32(255,0,0,255), IM_COL32(0,255,0,255) };
+    ParticleLife::BlockPool& blocks = ParticleLife::BlockPool::instance();
+
+    for (int huge = 0; huge < 2; ++huge)
+    {
+        for (int pinning = ParticleLife::Pinning_None; pinning < ParticleLife::Pinning_COUNT; ++pinning)
+        {
+            // Fresh mappings for every run, so each is placed by its own settings.
+            blocks.trim();
+            blocks.huge_pages = huge != 0;
+            ParticleLife::ThreadPool pool(threads);
+            const bool pinned = pool.pin(pinning);
+
+            ParticleGroups groups;
+            ParticleLife::Spawner spawner;
+            auto start = std::chrono::steady_clock::now();
+            spawner.respawn(groups, counts, colors, world, 1, pool);
+            const double spawn_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            ParticleLife::ForceBuffer forces;
+            forces.reset(4 * static_cast<std::size_t>(n));
+            const ParticleLife::Walls walls(world);
+            start = std::chrono::steady_clock::now();
+            for (int s = 0; s < steps; ++s)
+                ParticleLife::integrateAll(groups, forces, walls, ParticleLife::TimeStep(), pool);
+            const double groups_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / steps;
+
+            ParticleLife::ParticleStore<ParticleLife::LayoutSoA> store;
+            store.load(groups, 80.0f, pool);
+            start = std::chrono::steady_clock::now();
+            for (int s = 0; s < steps; ++s)
+            {
+                store.load(groups, 80.0f, pool);
+                ParticleLife::integrateStore(store, walls, ParticleLife::TimeStep(), pool);
+                store.scatter(groups, pool);
+            }
+            const double store_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / steps;
+
+            printf("  %-10s pinning %-8s spawn %8.2f ms  integrate %7.3f ms  store %8.3f ms  huge pages %ld kB%s\n",
+                huge ? "huge pages" : "4 KiB", ParticleLife::PinningNames[pinning], spawn_ms, groups_ms, store_ms, anonHugePagesKB(),
+                pinned ? "" : "  (pinning unavailable)");
+            pool.pin(ParticleLife::Pinning_None);
+        }
+    }
+    blocks.huge_pages = false;
+    blocks.trim();
+}
+
+// Sections named after the numeric arguments run alone; none runs everything.
+static bool wantSection(int argc, char** argv, const char* name)
+{
+    if (argc <= 4)
+        return true;
+    for (int i = 4; i < argc; ++i)
+        if (strcmp(argv[i], name) == 0)
+            return true;
+    return false;
+}
+
+int main(int argc, char** argv)
+{
+    const int per_group = argc > 1 ? atoi(argv[1]) : 1000;
+    const int steps = argc > 2 ? atoi(argv[2]) : 20;
+    const int threads = argc > 3 ? atoi(argv[3]) : ParticleLife::defaultThreadCount();
+    const ParticleLife::Params params = ParticleLife::defaultParams();
+    bool failed = false;
+
+    const Variant reference      = { "Reference",             makeSolver(ParticleLife::Kernel_Reference) };
+    const Variant fast           = { "Fast (hand-written)",   makeSolver(ParticleLife::Kernel_Fast) };
+    const Variant table_constant = { "Table constant",        makeSolver(ParticleLife::Kernel_Table) };
+    const Variant table_ramp     = { "Table linear ramp",     makeSolver(ParticleLife::Kernel_Table, 0, ParticleLife::ForceShape_LinearRamp) };
+    const Variant law_constant   = { "Law constant",          makeSolver(ParticleLife::Kernel_Law, ParticleLife::ForceLaw_Constant) };
+    const Variant law_linear     = { "Law linear falloff",    makeSolver(ParticleLife::Kernel_Law, ParticleLife::ForceLaw_LinearFalloff) };
+    const Variant law_lj         = { "Law Lennard-Jones",     makeSolver(ParticleLife::Kernel_Law, ParticleLife::ForceLaw_LennardJones) };
+    const Variant buffered       = { "Buffered",              makeBufferedSolver(ParticleLife::Kernel_Fast, false, 1) };
+    const Variant buffered_pairs = { "Buffered pairs",        makeBufferedSolver(ParticleLife::Kernel_Fast, true, 1) };
+    const Variant buffered_mt    = { "Buffered, all threads", makeBufferedSolver(ParticleLife::Kernel_Fast, false, threads) };
+    const Variant pairs_mt       = { "Pairs, all threads",    makeBufferedSolver(ParticleLife::Kernel_Fast, true, threads) };
+    Variant pairs_deterministic  = { "Pairs, deterministic",  makeBufferedSolver(ParticleLife::Kernel_Fast, true, threads) };
+    pairs_deterministic.solver.deterministic = true;
+    const Variant grid_mt        = { "Grid, all threads",     makeGridSolver(threads, ParticleLife::Balance_MeasuredCost) };
+    Variant grid_incremental     = { "Incremental grid",      makeGridSolver(threads, ParticleLife::Balance_MeasuredCost) };
+    grid_incremental.solver.grid.incremental = true;
+    Variant tree_mt              = { "Quadtree, all threads", makeBufferedSolver(ParticleLife::Kernel_Fast, false, threads) };
+    tree_mt.solver.spatial = ParticleLife::Spatial_QuadTree;
+    Variant sweep_mt             = { "Sweep, all threads",    makeBufferedSolver(ParticleLife::Kernel_Fast, false, threads) };
+    sweep_mt.solver.spatial = ParticleLife::Spatial_SweepAndPrune;
+    Variant unified_aos          = { "Unified AoS",           makeGridSolver(threads, ParticleLife::Balance_MeasuredCost) };
+    unified_aos.solver.storage = ParticleLife::Storage_AoS;
+    Variant unified_mt           = { "Unified SoA",           makeGridSolver(threads, ParticleLife::Balance_MeasuredCost) };
+    unified_mt.solver.storage = ParticleLife::Storage_SoA;
+    Variant unified_aosoa        = { "Unified AoSoA",         makeGridSolver(threads, ParticleLife::Balance_MeasuredCost) };
+    unified_aosoa.solver.storage = ParticleLife::Storage_AoSoA;
+    Variant unified_hot_cold     = { "Unified hot/cold",      makeGridSolver(threads, ParticleLife::Balance_MeasuredCost) };
+    unified_hot_cold.solver.storage = ParticleLife::Storage_HotCold;
+    Variant unified_quantised    = { "Unified, 16-bit",       unified_mt.solver };
+    unified_quantised.solver.quantised = true;
+    Variant hash_mt              = { "Hashed grid",           makeGridSolver(threads, ParticleLife::Balance_MeasuredCost) };
+    hash_mt.solver.spatial = ParticleLife::Spatial_HashGrid;
+
+    // Wrap-around world, every neighbour search against brute force.
+    Variant torus = buffered_mt, torus_pairs = pairs_mt, torus_grid = grid_mt, torus_tree = tree_mt, torus_sweep = sweep_mt;
+    torus.name = "Periodic";
+    torus_pairs.name = "Periodic pairs";
+    torus_grid.name = "Periodic grid";
+    torus_tree.name = "Periodic quadtree";
+    torus_sweep.name = "Periodic sweep";
+    for (Variant* variant : { &torus, &torus_pairs, &torus_grid, &torus_tree, &torus_sweep })
+        variant->solver.world.boundary = ParticleLife::Boundary_Periodic;
+
+    if (wantSection(argc, argv, "determinism"))
+    {
+        Variant adaptive = { "Adaptive grid", grid_mt.solver };
+        adaptive.solver.adaptive = true;
+        const Variant* variants[] = { &buffered_mt, &pairs_mt, &pairs_deterministic, &grid_mt, &grid_incremental, &unified_aos, &unified_mt, &unified_aosoa, &unified_hot_cold,
+                                      &unified_quantised, &tree_mt, &sweep_mt, &hash_mt, &torus, &torus_grid, &adaptive };
+        determinismReport(variants, sizeof(variants) / sizeof(variants[0]), params, per_group, threads);
+    }
+
+    if (wantSection(argc, argv, "accuracy"))
+    {
+        accuracyReport(reference, fast, params, per_group);
+        accuracyReport(reference, table_constant, params, per_group);
+        accuracyReport(fast, law_constant, params, per_group);
+        accuracyReport(table_ramp, law_linear, params, per_group);
+        accuracyReport(buffered, buffered_pairs, params, per_group);
+        accuracyReport(buffered, pairs_mt, params, per_group);
+        accuracyReport(buffered, grid_mt, params, per_group);
+        accuracyReport(buffered, tree_mt, params, per_group);
+        accuracyReport(buffered, sweep_mt, params, per_group);
+        accuracyReport(buffered, hash_mt, params, per_group);
+        accuracyReport(buffered, unified_mt, params, per_group);
+        accuracyReport(unified_mt, unified_aos, params, per_group);
+        accuracyReport(unified_mt, unified_aosoa, params, per_group);
+        accuracyReport(unified_mt, unified_hot_cold, params, per_group);
+        accuracyReport(reference, unified_mt, params, per_group);
+        accuracyReport(reference, unified_quantised, params, per_group);
+        accuracyReport(unified_mt, unified_quantised, params, per_group);
+        accuracyReport(grid_mt, grid_incremental, params, per_group);
+        accuracyReport(torus, torus_pairs, params, per_group);
+        accuracyReport(torus, torus_grid, params, per_group);
+        accuracyReport(torus, torus_tree, params, per_group);
+        accuracyReport(torus, torus_sweep, params, per_group);
+        tableReport(params);
+        substepReport(params, per_group, threads);
+    }
+
+    if (wantSection(argc, argv, "timing"))
+    {
+        const ParticleGroups groups = makeScene(per_group, 1);
+        printf("Timing (%d particles per group, %d steps, %d threads)\n", per_group, steps, threads);
+        const Variant* variants[] = { &reference, &fast, &table_constant, &table_ramp, &law_constant, &law_linear, &law_lj,
+                                      &buffered, &buffered_pairs, &buffered_mt, &pairs_mt, &pairs_deterministic, &grid_mt, &grid_incremental, &unified_aos, &unified_mt, &unified_aosoa, &unified_hot_cold,
+                                      &unified_quantised, &tree_mt, &sweep_mt, &hash_mt, &torus, &torus_grid };
+        double fast_ms = 0.0;
+        for (const Variant* variant : variants)
+        {
+            const double ms = timeSteps(groups, variant->solver, params, steps);
+            if (variant == &fast)
+                fast_ms = ms;
+            printf("  %-22s %8.3f ms/step", variant->name, ms);
+            if (fast_ms > 0.0 && variant != &fast)
+                printf("  (%.2fx hand-written)", ms / fast_ms);
+            printf("\n");
+        }
+    }
+
+    if (wantSection(argc, argv, "balance"))
+        balanceReport(params, per_group, steps, threads);
+    if (wantSection(argc, argv, "spatial"))
+    {
+        spatialReport(params, per_group, steps, threads);
+        sparseReport(params, per_group, steps, threads);
+    }
+    if (wantSection(argc, argv, "scaling"))
+        scalingReport(params, per_group, steps, threads);
+    if (wantSection(argc, argv, "layout"))
+        layoutReport(params, per_group, steps, threads);
+    if (wantSection(argc, argv, "spawn"))
+        spawnReport(threads);
+    if (wantSection(argc, argv, "memory"))
+        memoryReport(per_group, steps, threads);
+    if (wantSection(argc, argv, "allocations"))
+    {
+        Variant adaptive = { "Adaptive grid", grid_mt.solver };
+        adaptive.solver.adaptive = true;
+        const Variant* variants[] = { &fast, &buffered_mt, &pairs_mt, &pairs_deterministic, &grid_mt, &grid_incremental, &unified_mt, &unified_quantised,
+                                      &tree_mt, &sweep_mt, &hash_mt, &torus, &torus_grid, &adaptive };
+        if (!allocationReport(variants, sizeof(variants) / sizeof(variants[0]), params, per_group, steps))
+            failed = true;
+        if (!frameAllocationReport(grid_mt.solver, params, per_group, steps))
+            failed = true;
+    }
+    if (wantSection(argc, argv, "adaptive"))
+    {
+        adaptiveReport("default forces", params, per_group, threads);
+
+        // Weak enough that the clusters settle and velocities die away.
+        ParticleLife::Params gentle = params;
+        for (auto& row : gentle.forces)
+            for (float& g : row)
+                g *= 0.02f;
+        adaptiveReport("forces x 0.02", gentle, per_group, threads);
+    }
+
+    return failed ? 1 : 0;
+}
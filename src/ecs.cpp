@@ -12,6 +12,8 @@
 #include <array>
 #include <vector>
 #include "ParticleObject.h"
+#include "FastMath.h"
+#include "Random.h"
 #include <math.h>
 
 static void glfw_error_callback(int error, const char* description)
@@ -27,16 +29,12 @@ struct Velocity
 
 namespace ParticleLife
 {
-    inline float randomFloat(const float& max)
+    void addEntities(std::vector<ImVec2>& pos_component, int n, float x_max, float y_max, const Random& rng)
     {
-        return static_cast<float>((rand()) / static_cast<float>(RAND_MAX/max));
-    }
-
-    void addEntities(std::vector<ImVec2>& pos_component, int n, float x_max, float y_max)
-    {
-        pos_component.reserve(pos_component.size() + n);
-        for (int i = 0; i < n; ++i)
-            pos_component.push_back({randomFloat(x_max), randomFloat(y_max)});
+        const std::size_t first = pos_component.size();
+        pos_component.resize(first + n);
+        for (std::size_t k = first; k < first + n; ++k)
+            pos_component[k] = ImVec2(rng.uniformAt(2 * k) * x_max, rng.uniformAt(2 * k + 1) * y_max);
     }
 
     void rule(std::vector<ImVec2>& group1_pos_component, std::vector<Velocity>& group1_velocity_component, std::vector<ImVec2>& group2_pos_component, float g, const float& radius)
@@ -74,6 +72,44 @@ namespace ParticleLife
         }
     }
 
+    // Squared-distance cutoff with rsqrt() for accepted pairs only; float-only integration.
+    void ruleFast(std::vector<ImVec2>& group1_pos_component, std::vector<Velocity>& group1_velocity_component, std::vector<ImVec2>& group2_pos_component, float g, const float& radius)
+    {
+        const float min_d2 = 12.0f * 12.0f;
+        const float max_d2 = radius * radius;
+
+        for (std::size_t i = 0; i < group1_pos_component.size(); ++i)
+        {
+            auto& a_pos = group1_pos_component[i];
+            Velocity a_velocity = group1_velocity_component[i];    // a copy, as in rule()
+            float fx = 0.0f;
+            float fy = 0.0f;
+
+            for (std::size_t j = 0; j < group2_pos_component.size(); ++j)
+            {
+                const auto& b = group2_pos_component[j];
+                const float dx = a_pos.x - b.x;
+                const float dy = a_pos.y - b.y;
+                const float d2 = dx*dx + dy*dy;
+
+                if (d2 > min_d2 && d2 < max_d2)
+                {
+                    const float F = g * rsqrt(d2);
+                    fx += dx * F;
+                    fy += dy * F;
+                }
+            }
+            a_velocity.vx = (a_velocity.vx + fx) * (1.0f - 0.2f);
+            a_velocity.vy = (a_velocity.vy + fy) * (1.0f - 0.2f);
+            if (a_pos.x < 0.0f && a_velocity.vx < 0.0f) a_velocity.vx = -a_velocity.vx;
+            if (a_pos.x > 1390.0f && a_velocity.vx > 0.0f) a_velocity.vx = -a_velocity.vx;
+            if (a_pos.y < 0.0f && a_velocity.vy < 0.0f) a_velocity.vy = -a_velocity.vy;
+            if (a_pos.y > 1190.0f && a_velocity.vy > 0.0f) a_velocity.vy = -a_velocity.vy;
+            a_pos.x += a_velocity.vx;
+            a_pos.y += a_velocity.vy;
+        }
+    }
+
     void move(std::vector<ParticleObject>& particles)
     {
         for (auto& p : particles)
@@ -144,10 +180,10 @@ int main(int, char**)
     std::vector<ImVec2> red_pos_component;
     std::vector<ImVec2> green_pos_component;
 
-    ParticleLife::addEntities(white_pos_component, 1000, 1600.0f, 1200.0f);
-    ParticleLife::addEntities(blue_pos_component, 1000, 1600.0f, 1200.0f);
-    ParticleLife::addEntities(red_pos_component, 1000, 1600.0f, 1200.0f);
-    ParticleLife::addEntities(green_pos_component, 1000, 1600.0f, 1200.0f);
+    ParticleLife::addEntities(white_pos_component, 1000, 1600.0f, 1200.0f, ParticleLife::Random(1, 0));
+    ParticleLife::addEntities(blue_pos_component, 1000, 1600.0f, 1200.0f, ParticleLife::Random(1, 1));
+    ParticleLife::addEntities(red_pos_component, 1000, 1600.0f, 1200.0f, ParticleLife::Random(1, 2));
+    ParticleLife::addEntities(green_pos_component, 1000, 1600.0f, 1200.0f, ParticleLife::Random(1, 3));
 
     std::vector<Velocity> white_velocity_component(white_pos_component.size(), {0, 0});
     std::vector<Velocity> blue_velocity_component(blue_pos_component.size(), {0, 0});
@@ -182,6 +218,8 @@ int main(int, char**)
     float fgreen_red = -0.4142f;
     float fgreen_green = -0.251f;
 
+    bool use_fast_kernel = true;
+
     // Main loop
     while (!glfwWindowShouldClose(window))
     {
@@ -197,6 +235,8 @@ int main(int, char**)
                 ImGui::SetNextWindowSize(ImVec2(SETTINGS_WIDTH, DISPLAY_HEIGHT));
                 ImGui::Begin("Settings", NULL, ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize);
 
+                ImGui::Checkbox("Fast kernel (rsqrt)", &use_fast_kernel);
+
                 if (ImGui::CollapsingHeader("White", NULL, ImGuiTreeNodeFlags_DefaultOpen))
                 {
                     ImGui::DragScalar("White Radius",     ImGuiDataType_Float,  &white_radius, 1.0f,  &fmin_radius, &fmax_radius, "%f");
@@ -236,40 +276,42 @@ int main(int, char**)
 
                 ImGui::End();
             }
+            const auto rule = use_fast_kernel ? ParticleLife::ruleFast : ParticleLife::rule;
+
             // WHITE
             if (white_pos_component.size() > 0)
             {
-                ParticleLife::rule(white_pos_component, white_velocity_component, white_pos_component, fwhite_white, white_radius);
-                ParticleLife::rule(white_pos_component, white_velocity_component, blue_pos_component, fwhite_blue, white_radius);
-                ParticleLife::rule(white_pos_component, white_velocity_component, red_pos_component, fwhite_red, white_radius);
-                ParticleLife::rule(white_pos_component, white_velocity_component, green_pos_component, fwhite_green, white_radius);
+                rule(white_pos_component, white_velocity_component, white_pos_component, fwhite_white, white_radius);
+                rule(white_pos_component, white_velocity_component, blue_pos_component, fwhite_blue, white_radius);
+                rule(white_pos_component, white_velocity_component, red_pos_component, fwhite_red, white_radius);
+                rule(white_pos_component, white_velocity_component, green_pos_component, fwhite_green, white_radius);
             }
 
             // BLUE
             if (blue_pos_component.size() > 0)
             {
-                ParticleLife::rule(blue_pos_component, blue_velocity_component, white_pos_component, fblue_white, blue_radius);
-                ParticleLife::rule(blue_pos_component, blue_velocity_component, blue_pos_component, fblue_blue, blue_radius);
-                ParticleLife::rule(blue_pos_component, blue_velocity_component, red_pos_component, fblue_red, blue_radius);
-                ParticleLife::rule(blue_pos_component, blue_velocity_component, green_pos_component, fblue_green, blue_radius);
+                rule(blue_pos_component, blue_velocity_component, white_pos_component, fblue_white, blue_radius);
+                rule(blue_pos_component, blue_velocity_component, blue_pos_component, fblue_blue, blue_radius);
+                rule(blue_pos_component, blue_velocity_component, red_pos_component, fblue_red, blue_radius);
+                rule(blue_pos_component, blue_velocity_component, green_pos_component, fblue_green, blue_radius);
             }
 
             // RED
             if (red_pos_component.size() > 0)
             {
-                ParticleLife::rule(red_pos_component, red_velocity_component, white_pos_component, fred_white, red_radius);
-                ParticleLife::rule(red_pos_component, red_velocity_component, blue_pos_component, fred_blue, red_radius);
-                ParticleLife::rule(red_pos_component, red_velocity_component, red_pos_component, fred_red, red_radius);
-                ParticleLife::rule(red_pos_component, red_velocity_component, green_pos_component, fred_green, red_radius);
+                rule(red_pos_component, red_velocity_component, white_pos_component, fred_white, red_radius);
+                rule(red_pos_component, red_velocity_component, blue_pos_component, fred_blue, red_radius);
+                rule(red_pos_component, red_velocity_component, red_pos_component, fred_red, red_radius);
+                rule(red_pos_component, red_velocity_component, green_pos_component, fred_green, red_radius);
             }
 
             // GREEN
             if (green_pos_component.size() > 0)
             {
-                ParticleLife::rule(green_pos_component, green_velocity_component, white_pos_component, fgreen_white, green_radius);
-                ParticleLife::rule(green_pos_component, green_velocity_component, blue_pos_component, fgreen_blue, green_radius);
-                ParticleLife::rule(green_pos_component, green_velocity_component, red_pos_component, fgreen_red, green_radius);
-                ParticleLife::rule(green_pos_component, green_velocity_component, green_pos_component, fgreen_green, green_radius);
+                rule(green_pos_component, green_velocity_component, white_pos_component, fgreen_white, green_radius);
+                rule(green_pos_component, green_velocity_component, blue_pos_component, fgreen_blue, green_radius);
+                rule(green_pos_component, green_velocity_component, red_pos_component, fgreen_red, green_radius);
+                rule(green_pos_component, green_velocity_component, green_pos_component, fgreen_green, green_radius);
             }
 
             // move particles only after all forces have been recalculated
@@ -10,74 +10,23 @@
 #endif
 #include <GLFW/glfw3.h> // Will drag system OpenGL headers
 
+#include <algorithm>
 #include <array>
+#include <chrono>
 #include <vector>
+#define PARTICLE_LIFE_ALLOCATION_HOOKS
+#include "AllocationTracker.h"
 #include "ParticleObject.h"
-#include <math.h>
+#include "ParticleLife.h"
+#include "Canvas.h"
+#include "Solver.h"
+#include "Spawner.h"
 
 static void glfw_error_callback(int error, const char* description)
 {
     fprintf(stderr, "Glfw Error %d: %s\n", error, description);
 }
 
-namespace ParticleLife
-{
-    inline float randomFloat(const float& max)
-    {
-        return static_cast<float>((rand()) / static_cast<float>(RAND_MAX/max));
-    }
-
-    void addPoints(std::vector<ParticleObject>& particles, int n, float x_max, float y_max, ImU32 color)
-    {
-        particles.reserve(particles.size() + n);
-        for (int i = 0; i < n; ++i)
-            particles.push_back({randomFloat(x_max), randomFloat(y_max), 0.0f, 0.0f, color});
-    }
-
-    void rule(std::vector<ParticleObject>& group1, std::vector<ParticleObject>& group2, float g, const float& radius)
-    {
-        for (std::size_t i = 0; i < group1.size(); ++i)
-        {
-            auto& a = group1[i];
-            float fx = 0;
-            float fy = 0;
-
-            for (std::size_t j = 0; j < group2.size(); ++j)
-            {
-                const auto& b = group2[j];
-                const auto dx = a.x - b.x;
-                const auto dy = a.y - b.y;
-                const auto d = std::sqrt(dx*dx + dy*dy);
-
-                float F = 0.0f;
-                if (d > 12.0f && d < radius)
-                {
-                    F = (g / d);
-                    fx += dx * F;
-                    fy += dy * F;
-                }
-            }
-            a.vx = (a.vx + fx) * (1.0 - 0.2);
-            a.vy = (a.vy + fy) * (1.0 - 0.2);
-            if (a.x < 0.0f && a.vx < 0) a.vx *= -1.0;
-            if (a.x > 1390.0f && a.vx > 0) a.vx *= -1.0;
-            if (a.y < 0.0f && a.vy < 0) a.vy *= -1.0;
-            if (a.y > 1190.0f && a.vy > 0) a.vy *= -1.0;
-            a.x += a.vx;
-            a.y += a.vy;
-        }
-    }
-
-    void move(std::vector<ParticleObject>& particles)
-    {
-        for (auto& p : particles)
-        {
-            p.x += p.vx;
-            p.y += p.vy;
-        }
-    }
-}
-
 
 int main(int, char**)
 {
@@ -112,7 +61,7 @@ int main(int, char**)
 #define DISPLAY_WIDTH  1800
 #define DISPLAY_HEIGHT 1200
 #define SETTINGS_WIDTH 401.0f
-#define WORLD_WIDTH    1400.0f
+#define CANVAS_WIDTH   1400.0f
     // Create window with graphics context
     GLFWwindow* window = glfwCreateWindow(DISPLAY_WIDTH, DISPLAY_HEIGHT, "Particle Life", NULL, NULL);
     if (window == NULL)
@@ -122,6 +71,7 @@ int main(int, char**)
 
     // Setup Dear ImGui context
     IMGUI_CHECKVERSION();
+    ImGui::SetAllocatorFunctions(ParticleLife::AllocationTracker::imguiAlloc, ParticleLife::AllocationTracker::imguiFree);
     ImGui::CreateContext();
     ImGuiIO& io = ImGui::GetIO(); (void)io;
 
@@ -136,49 +86,81 @@ int main(int, char**)
     // Our state
     ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
 
-    std::array<std::vector<ParticleObject>, 4> particle_groups;
-    particle_groups.fill(std::vector<ParticleObject>());
+    ParticleLife::ParticleGroups particle_groups;
     #define WHITE_PARTICLES particle_groups[0]
     #define BLUE_PARTICLES  particle_groups[1]
     #define RED_PARTICLES  particle_groups[2]
     #define GREEN_PARTICLES particle_groups[3]
 
-    ParticleLife::addPoints(WHITE_PARTICLES, 1000, 1600.0f, 1200.0f, IM_COL32_WHITE);
-    ParticleLife::addPoints(BLUE_PARTICLES, 1000, 1600.0f, 1200.0f, IM_COL32(0,0,255,255));
-    ParticleLife::addPoints(RED_PARTICLES, 1000, 1600.0f, 1200.0f, IM_COL32(255,0,0,255));
-    ParticleLife::addPoints(GREEN_PARTICLES, 1000, 1600.0f, 1200.0f, IM_COL32(0,255,0,255));
+    ParticleLife::Solver solver;
+    const ParticleLife::WorldBounds& world = solver.world;
+    // Reset starts over from the same seed, Respawn moves on to the next one.
+    // Both refill the groups in place and drop the solver's incremental state.
+    // The counts are also applied live, in the Settings window below.
+    ParticleLife::Spawner spawner;
+    const ImU32 colors[ParticleLife::GroupCount] = { IM_COL32_WHITE, IM_COL32(0,0,255,255), IM_COL32(255,0,0,255), IM_COL32(0,255,0,255) };
+    int counts[ParticleLife::GroupCount] = { 1000, 1000, 1000, 1000 };
+    int seed = 1;   // one Random stream per group
+    int batch = 0;  // count changes so far; each draws from streams of its own
+    float respawn_ms = 0.0f;
+    const auto respawn = [&]()
+    {
+        const auto start = std::chrono::steady_clock::now();
+        spawner.respawn(particle_groups, counts, colors, world, seed, solver.threadPool());
+        solver.invalidate();
+        respawn_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+    respawn();
 
     float f32_minus_one = -1.0f, f32_one = 1.0f;
-    float fmin_radius = 50.0f, fmax_radius = WORLD_WIDTH;
-
-    float white_radius = 455.0;
-    float blue_radius = 112.0;
-    float red_radius = 80.0;
-    float green_radius = 150.0;
-
-    float fwhite_white = -0.1501;
-    float fwhite_blue = -0.372f;
-    float fwhite_red = -0.432f;
-    float fwhite_green = -0.00344f;
-
-    float fblue_white = -0.00015f;
-    float fblue_blue = 0.0f;
-    float fblue_red = -0.00051;
-    float fblue_green = -0.00035;
-
-    float fred_white = 0.1381f;
-    float fred_blue = 0.321f;
-    float fred_red = -0.9f;
-    float fred_green = -0.2304f;
-
-    float fgreen_white = -0.4151f;
-    float fgreen_blue = 0.0006f;
-    float fgreen_red = -0.4142f;
-    float fgreen_green = -0.251f;
+    float fmin_radius = 50.0f, fmax_radius = CANVAS_WIDTH;
+
+    ParticleLife::Params params = ParticleLife::defaultParams();
+    #define WHITE 0
+    #define BLUE  1
+    #define RED   2
+    #define GREEN 3
+
+    float fmin_core = 0.05f, fmax_core = 0.9f;
+    float fmin_sigma = 1.0f, fmax_sigma = 100.0f;
+    float fmin_epsilon = 0.0f, fmax_epsilon = 10.0f;
+    int min_threads = 1, max_threads = ParticleLife::defaultThreadCount();
+    float fmin_cell = 0.0f, fmax_cell = CANVAS_WIDTH;
+    float fmin_world = 200.0f, fmax_world = 100000.0f;
+    float fmin_lod = 0.01f, fmax_lod = 2.0f;
+    int min_count = 0, max_count = 1000000;
+    int min_clusters = 1, max_clusters = ParticleLife::Spawner::MaxClusters;
+    float fmin_cluster = 1.0f, fmax_cluster = 1000.0f;
+    float fmin_fraction = 0.0f, fmax_fraction = 0.5f;
+    float fmin_dt = 0.05f, fmax_dt = 2.0f;
+    float fmin_rate = 10.0f, fmax_rate = 240.0f;
+    int min_substeps = 1, max_substeps = 16;
+    int min_steps = 1, max_steps = 16;
+    float fmin_move = 0.5f, fmax_move = 200.0f;
+    float fmax_adaptive_dt = 32.0f;
+
+    ParticleLife::FixedStepClock clock;
+
+    // Heap allocations of the whole last frame, from polling events to swapping
+    // buffers; once warm there should be none.
+    const ParticleLife::AllocationTracker& tracker = ParticleLife::AllocationTracker::instance();
+    ParticleLife::AllocationTracker::Counts frame_start = tracker.counts();
+    ParticleLife::AllocationTracker::Counts last_frame = { 0, 0 };
+    int clean_frames = 0;
+
+    ParticleLife::Camera camera;
+    camera.fit(world, CANVAS_WIDTH, DISPLAY_HEIGHT);
+    ParticleLife::CanvasRenderer renderer;
+    int min_split = 4, max_split = 512, min_merge = 0;
+    int min_rebuild = 1, max_rebuild = 1000;
 
     // Main loop
     while (!glfwWindowShouldClose(window))
     {
+        last_frame = tracker.since(frame_start);
+        frame_start = tracker.counts();
+        clean_frames = last_frame.allocations == 0 ? clean_frames + 1 : 0;
+
         glfwPollEvents();
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
@@ -191,80 +173,218 @@ int main(int, char**)
                 ImGui::SetNextWindowSize(ImVec2(SETTINGS_WIDTH, DISPLAY_HEIGHT));
                 ImGui::Begin("Settings", NULL, ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize);
 
+                if (ImGui::Button("Reset"))
+                    respawn();
+                ImGui::SameLine();
+                if (ImGui::Button("Respawn"))
+                {
+                    ++seed;
+                    respawn();
+                }
+                ImGui::SameLine();
+                ImGui::Text("seed %d, %.2f ms", seed, respawn_ms);
+                if (ImGui::CollapsingHeader("Spawn"))
+                {
+                    ImGui::Combo("Distribution", &spawner.distribution, ParticleLife::DistributionNames, ParticleLife::Distribution_COUNT);
+                    if (spawner.distribution == ParticleLife::Distribution_Clustered)
+                    {
+                        ImGui::SliderScalar("Clusters", ImGuiDataType_S32, &spawner.clusters, &min_clusters, &max_clusters);
+                        ImGui::DragScalar("Cluster radius", ImGuiDataType_Float, &spawner.cluster_radius, 1.0f, &fmin_cluster, &fmax_cluster, "%f");
+                    }
+                    if (spawner.distribution == ParticleLife::Distribution_Ring)
+                    {
+                        ImGui::DragScalar("Ring radius", ImGuiDataType_Float, &spawner.ring_radius, 0.005f, &fmin_fraction, &fmax_fraction, "%f");
+                        ImGui::DragScalar("Ring width", ImGuiDataType_Float, &spawner.ring_width, 0.005f, &fmin_fraction, &fmax_fraction, "%f");
+                    }
+                    ImGui::InputInt("Seed", &seed);
+                    ImGui::DragScalar("White count", ImGuiDataType_S32, &counts[WHITE], 10.0f, &min_count, &max_count);
+                    ImGui::DragScalar("Blue count", ImGuiDataType_S32, &counts[BLUE], 10.0f, &min_count, &max_count);
+                    ImGui::DragScalar("Red count", ImGuiDataType_S32, &counts[RED], 10.0f, &min_count, &max_count);
+                    ImGui::DragScalar("Green count", ImGuiDataType_S32, &counts[GREEN], 10.0f, &min_count, &max_count);
+                    ImGui::Text("Capacity %d, %d, %d, %d", static_cast<int>(WHITE_PARTICLES.capacity()), static_cast<int>(BLUE_PARTICLES.capacity()),
+                        static_cast<int>(RED_PARTICLES.capacity()), static_cast<int>(GREEN_PARTICLES.capacity()));
+                    ParticleLife::BlockPool& blocks = ParticleLife::BlockPool::instance();
+                    ImGui::Text("Pool %d KB held, %d KB in use, %d heap allocations, %d reuses", static_cast<int>(blocks.reserved / 1024), static_cast<int>(blocks.in_use / 1024),
+                        static_cast<int>(blocks.heap_allocations), static_cast<int>(blocks.reuses));
+                    ImGui::Checkbox("Huge pages", &blocks.huge_pages);
+                    if (blocks.advised > 0)
+                        ImGui::Text("%d KB advised as huge pages", static_cast<int>(blocks.advised / 1024));
+                }
+
+                // Counts apply live: removals swap the last particle into the gap,
+                // additions are spawned at the end.
+                for (int g = 0; g < ParticleLife::GroupCount; ++g)
+                {
+                    if (counts[g] == static_cast<int>(particle_groups[g].size()))
+                        continue;
+                    ParticleLife::Random rng(seed, g + ParticleLife::GroupCount * ++batch);
+                    spawner.resize(particle_groups[g], counts[g], world, colors[g], rng, solver.threadPool());
+                }
+
+                ImGui::Combo("Integrator", &solver.integrator, ParticleLife::IntegratorNames, ParticleLife::Integrator_COUNT);
+                if (solver.integrator == ParticleLife::Integrator_Buffered)
+                {
+                    ImGui::SliderScalar("Threads", ImGuiDataType_S32, &solver.threads, &min_threads, &max_threads);
+                    ImGui::Combo("Pinning", &solver.pinning, ParticleLife::PinningNames, ParticleLife::Pinning_COUNT);
+                    ImGui::Checkbox("Deterministic", &solver.deterministic);
+                    ImGui::Combo("Spatial", &solver.spatial, ParticleLife::SpatialNames, ParticleLife::Spatial_COUNT);
+                    if (solver.spatial == ParticleLife::Spatial_BruteForce)
+                        ImGui::Checkbox("Newton pairs", &solver.newton_pairs);
+                    if (solver.spatial == ParticleLife::Spatial_Grid)
+                    {
+                        ImGui::DragScalar("Cell size (0 = auto)", ImGuiDataType_Float, &solver.cell_size, 1.0f, &fmin_cell, &fmax_cell, "%f");
+                        ImGui::Combo("Balance", &solver.balancer.mode, ParticleLife::BalanceNames, ParticleLife::Balance_COUNT);
+                        ImGui::Combo("Storage", &solver.storage, ParticleLife::StorageNames, ParticleLife::Storage_COUNT);
+                        if (solver.storage != ParticleLife::Storage_Groups && solver.world.boundary == ParticleLife::Boundary_Periodic)
+                            ImGui::TextDisabled("Periodic worlds use the groups");
+                        else if (solver.storage != ParticleLife::Storage_Groups && solver.world.boundary == ParticleLife::Boundary_Open)
+                            ImGui::TextDisabled("Open worlds use float positions");
+                        else if (solver.storage != ParticleLife::Storage_Groups)
+                        {
+                            ImGui::Checkbox("Quantised positions", &solver.quantised);
+                            if (solver.quantised && solver.quantum > 0.0f)
+                                ImGui::Text("Position step %.4f", solver.quantum);
+                            else if (solver.quantised)
+                                ImGui::TextDisabled("World too large, float positions");
+                        }
+                        ImGui::Checkbox("Incremental", &solver.grid.incremental);
+                        if (solver.grid.incremental)
+                        {
+                            ImGui::SliderScalar("Rebuild every", ImGuiDataType_S32, &solver.grid.rebuild_interval, &min_rebuild, &max_rebuild);
+                            ImGui::Text("Migrated %.2f%%%s", solver.grid.migrated_fraction * 100.0f, solver.grid.rebuilt ? " (rebuilt)" : "");
+                        }
+                    }
+                    if (solver.spatial == ParticleLife::Spatial_QuadTree)
+                    {
+                        ImGui::SliderScalar("Split above", ImGuiDataType_S32, &solver.tree.split_threshold, &min_split, &max_split);
+                        ImGui::SliderScalar("Merge at or below", ImGuiDataType_S32, &solver.tree.merge_threshold, &min_merge, &solver.tree.split_threshold);
+                        ImGui::Text("Leaves %d, migrated %d", static_cast<int>(solver.tree.leaves().size()), static_cast<int>(solver.tree.migrated));
+                    }
+                    if (solver.spatial == ParticleLife::Spatial_HashGrid)
+                    {
+                        ImGui::DragScalar("Cell size (0 = auto)", ImGuiDataType_Float, &solver.cell_size, 1.0f, &fmin_cell, &fmax_cell, "%f");
+                        ImGui::Combo("Balance", &solver.balancer.mode, ParticleLife::BalanceNames, ParticleLife::Balance_COUNT);
+                        ImGui::Text("Occupied cells %d, table slots %d", solver.hash.cellCount(), static_cast<int>(solver.hash.capacity()));
+                    }
+                    if (solver.spatial == ParticleLife::Spatial_SweepAndPrune)
+                        ImGui::Text("Insertion sort moves %d", static_cast<int>(solver.sweep.shifts));
+                }
+                ImGui::Combo("Kernel", &solver.kernel, ParticleLife::KernelNames, ParticleLife::Kernel_COUNT);
+                if (solver.kernel == ParticleLife::Kernel_Table)
+                {
+                    ImGui::Combo("Force profile", &solver.tables.shape, ParticleLife::ForceShapeNames, ParticleLife::ForceShape_COUNT);
+                    if (solver.tables.shape == ParticleLife::ForceShape_SoftCore)
+                        ImGui::DragScalar("Core fraction", ImGuiDataType_Float, &solver.tables.core, 0.005f, &fmin_core, &fmax_core, "%f");
+                }
+                if (solver.kernel == ParticleLife::Kernel_Law)
+                {
+                    ImGui::Combo("Force law", &solver.law, ParticleLife::ForceLawNames, ParticleLife::ForceLaw_COUNT);
+                    if (solver.law == ParticleLife::ForceLaw_LennardJones)
+                    {
+                        ImGui::DragScalar("Sigma", ImGuiDataType_Float, &solver.law_settings.sigma, 0.1f, &fmin_sigma, &fmax_sigma, "%f");
+                        ImGui::DragScalar("Epsilon", ImGuiDataType_Float, &solver.law_settings.epsilon, 0.01f, &fmin_epsilon, &fmax_epsilon, "%f");
+                    }
+                }
+
+                if (ImGui::CollapsingHeader("World"))
+                {
+                    ImGui::DragScalar("Width", ImGuiDataType_Float, &solver.world.width, 10.0f, &fmin_world, &fmax_world, "%f");
+                    ImGui::DragScalar("Height", ImGuiDataType_Float, &solver.world.height, 10.0f, &fmin_world, &fmax_world, "%f");
+                    ImGui::Combo("Boundary", &solver.world.boundary, ParticleLife::BoundaryNames, ParticleLife::Boundary_COUNT);
+                    if (solver.world.boundary == ParticleLife::Boundary_Periodic && solver.integrator != ParticleLife::Integrator_Buffered)
+                        ImGui::TextDisabled("Wrapping needs the buffered integrator");
+                    if (ImGui::Button("Fit view"))
+                        camera.fit(world, CANVAS_WIDTH, DISPLAY_HEIGHT);
+                    ImGui::DragScalar("Density below zoom", ImGuiDataType_Float, &renderer.lod_zoom, 0.005f, &fmin_lod, &fmax_lod, "%f");
+                    ImGui::Text("Zoom %.3f, drawn %d of %d visited%s", camera.zoom, static_cast<int>(renderer.drawn), static_cast<int>(renderer.visited), renderer.density ? " (density)" : "");
+                }
+                if (ImGui::CollapsingHeader("Time step"))
+                {
+                    ImGui::Checkbox("Adaptive", &solver.adaptive);
+                    if (solver.adaptive && solver.integrator == ParticleLife::Integrator_Buffered)
+                    {
+                        ImGui::DragScalar("Max move per substep", ImGuiDataType_Float, &solver.max_move, 0.1f, &fmin_move, &fmax_move, "%f");
+                        ImGui::DragScalar("Min dt", ImGuiDataType_Float, &solver.min_dt, 0.01f, &fmin_dt, &solver.max_dt, "%f");
+                        ImGui::DragScalar("Max dt", ImGuiDataType_Float, &solver.max_dt, 0.01f, &solver.min_dt, &fmax_adaptive_dt, "%f");
+                        ImGui::Text("dt %.3f, max speed %.2f, max force %.2f", solver.last_dt, solver.motion.max_speed, solver.motion.max_force);
+                    }
+                    else
+                    {
+                        if (solver.adaptive)
+                            ImGui::TextDisabled("Adaptive steps need the buffered integrator");
+                        ImGui::DragScalar("dt", ImGuiDataType_Float, &solver.dt, 0.01f, &fmin_dt, &fmax_dt, "%f");
+                    }
+                    ImGui::SliderScalar("Substeps", ImGuiDataType_S32, &solver.substeps, &min_substeps, &max_substeps);
+                    ImGui::DragScalar("Steps per second", ImGuiDataType_Float, &clock.rate, 1.0f, &fmin_rate, &fmax_rate, "%f");
+                    ImGui::SliderScalar("Max steps per frame", ImGuiDataType_S32, &clock.max_steps, &min_steps, &max_steps);
+                    ImGui::Text("Steps this frame %d%s, simulated time %.1f", clock.steps, clock.dropped ? " (dropped)" : "", solver.simulated_time);
+                }
                 if (ImGui::CollapsingHeader("White", NULL, ImGuiTreeNodeFlags_DefaultOpen))
                 {
-                    ImGui::DragScalar("White Radius",     ImGuiDataType_Float,  &white_radius, 1.0f,  &fmin_radius, &fmax_radius, "%f");
+                    ImGui::DragScalar("White Radius",     ImGuiDataType_Float,  &params.radius[WHITE], 1.0f,  &fmin_radius, &fmax_radius, "%f");
                     ImGui::NewLine();
-                    ImGui::DragScalar("White->White",     ImGuiDataType_Float,  &fwhite_white, 0.001f,  &f32_minus_one, &f32_one, "%f");
-                    ImGui::DragScalar("White->Blue",     ImGuiDataType_Float,  &fwhite_blue, 0.001f,  &f32_minus_one, &f32_one, "%f");
-                    ImGui::DragScalar("White->Red",     ImGuiDataType_Float,  &fwhite_red, 0.001f,  &f32_minus_one, &f32_one, "%f");
-                    ImGui::DragScalar("White->Green",     ImGuiDataType_Float,  &fwhite_green, 0.001f,  &f32_minus_one, &f32_one, "%f");
+                    ImGui::DragScalar("White->White",     ImGuiDataType_Float,  &params.forces[WHITE][WHITE], 0.001f,  &f32_minus_one, &f32_one, "%f");
+                    ImGui::DragScalar("White->Blue",     ImGuiDataType_Float,  &params.forces[WHITE][BLUE], 0.001f,  &f32_minus_one, &f32_one, "%f");
+                    ImGui::DragScalar("White->Red",     ImGuiDataType_Float,  &params.forces[WHITE][RED], 0.001f,  &f32_minus_one, &f32_one, "%f");
+                    ImGui::DragScalar("White->Green",     ImGuiDataType_Float,  &params.forces[WHITE][GREEN], 0.001f,  &f32_minus_one, &f32_one, "%f");
                 }
                 if (ImGui::CollapsingHeader("Blue", NULL, ImGuiTreeNodeFlags_DefaultOpen))
                 {
-                    ImGui::DragScalar("Blue Radius",     ImGuiDataType_Float,  &blue_radius, 1.0f,  &fmin_radius, &fmax_radius, "%f");
+                    ImGui::DragScalar("Blue Radius",     ImGuiDataType_Float,  &params.radius[BLUE], 1.0f,  &fmin_radius, &fmax_radius, "%f");
                     ImGui::NewLine();
-                    ImGui::DragScalar("Blue->White",     ImGuiDataType_Float,  &fblue_white, 0.001f,  &f32_minus_one, &f32_one, "%f");
-                    ImGui::DragScalar("Blue->Blue",     ImGuiDataType_Float,  &fblue_blue, 0.001f,  &f32_minus_one, &f32_one, "%f");
-                    ImGui::DragScalar("Blue->Red",     ImGuiDataType_Float,  &fblue_red, 0.001f,  &f32_minus_one, &f32_one, "%f");
-                    ImGui::DragScalar("Blue->Green",     ImGuiDataType_Float,  &fblue_green, 0.001f,  &f32_minus_one, &f32_one, "%f");
+                    ImGui::DragScalar("Blue->White",     ImGuiDataType_Float,  &params.forces[BLUE][WHITE], 0.001f,  &f32_minus_one, &f32_one, "%f");
+                    ImGui::DragScalar("Blue->Blue",     ImGuiDataType_Float,  &params.forces[BLUE][BLUE], 0.001f,  &f32_minus_one, &f32_one, "%f");
+                    ImGui::DragScalar("Blue->Red",     ImGuiDataType_Float,  &params.forces[BLUE][RED], 0.001f,  &f32_minus_one, &f32_one, "%f");
+                    ImGui::DragScalar("Blue->Green",     ImGuiDataType_Float,  &params.forces[BLUE][GREEN], 0.001f,  &f32_minus_one, &f32_one, "%f");
                 }
                 if (ImGui::CollapsingHeader("Red", NULL, ImGuiTreeNodeFlags_DefaultOpen))
                 {
-                    ImGui::DragScalar("Red Radius",     ImGuiDataType_Float,  &red_radius, 1.0f,  &fmin_radius, &fmax_radius, "%f");
+                    ImGui::DragScalar("Red Radius",     ImGuiDataType_Float,  &params.radius[RED], 1.0f,  &fmin_radius, &fmax_radius, "%f");
                     ImGui::NewLine();
-                    ImGui::DragScalar("Red->White",     ImGuiDataType_Float,  &fred_white, 0.001f,  &f32_minus_one, &f32_one, "%f");
-                    ImGui::DragScalar("Red->Blue",     ImGuiDataType_Float,  &fred_blue, 0.001f,  &f32_minus_one, &f32_one, "%f");
-                    ImGui::DragScalar("Red->Red",     ImGuiDataType_Float,  &fred_red, 0.001f,  &f32_minus_one, &f32_one, "%f");
-                    ImGui::DragScalar("Red->Green",     ImGuiDataType_Float,  &fred_green, 0.001f,  &f32_minus_one, &f32_one, "%f");
+                    ImGui::DragScalar("Red->White",     ImGuiDataType_Float,  &params.forces[RED][WHITE], 0.001f,  &f32_minus_one, &f32_one, "%f");
+                    ImGui::DragScalar("Red->Blue",     ImGuiDataType_Float,  &params.forces[RED][BLUE], 0.001f,  &f32_minus_one, &f32_one, "%f");
+                    ImGui::DragScalar("Red->Red",     ImGuiDataType_Float,  &params.forces[RED][RED], 0.001f,  &f32_minus_one, &f32_one, "%f");
+                    ImGui::DragScalar("Red->Green",     ImGuiDataType_Float,  &params.forces[RED][GREEN], 0.001f,  &f32_minus_one, &f32_one, "%f");
                 }
                 if (ImGui::CollapsingHeader("Green", NULL, ImGuiTreeNodeFlags_DefaultOpen))
                 {
-                    ImGui::DragScalar("Green Radius",     ImGuiDataType_Float,  &green_radius, 1.0f,  &fmin_radius, &fmax_radius, "%f");
+                    ImGui::DragScalar("Green Radius",     ImGuiDataType_Float,  &params.radius[GREEN], 1.0f,  &fmin_radius, &fmax_radius, "%f");
                     ImGui::NewLine();
-                    ImGui::DragScalar("Green->White",     ImGuiDataType_Float,  &fgreen_white, 0.001f,  &f32_minus_one, &f32_one, "%f");
-                    ImGui::DragScalar("Green->Blue",     ImGuiDataType_Float,  &fgreen_blue, 0.001f,  &f32_minus_one, &f32_one, "%f");
-                    ImGui::DragScalar("Green->Red",     ImGuiDataType_Float,  &fgreen_red, 0.001f,  &f32_minus_one, &f32_one, "%f");
-                    ImGui::DragScalar("Green->Green",     ImGuiDataType_Float,  &fgreen_green, 0.001f,  &f32_minus_one, &f32_one, "%f");
+                    ImGui::DragScalar("Green->White",     ImGuiDataType_Float,  &params.forces[GREEN][WHITE], 0.001f,  &f32_minus_one, &f32_one, "%f");
+                    ImGui::DragScalar("Green->Blue",     ImGuiDataType_Float,  &params.forces[GREEN][BLUE], 0.001f,  &f32_minus_one, &f32_one, "%f");
+                    ImGui::DragScalar("Green->Red",     ImGuiDataType_Float,  &params.forces[GREEN][RED], 0.001f,  &f32_minus_one, &f32_one, "%f");
+                    ImGui::DragScalar("Green->Green",     ImGuiDataType_Float,  &params.forces[GREEN][GREEN], 0.001f,  &f32_minus_one, &f32_one, "%f");
+                }
+                if (ImGui::CollapsingHeader("Performance", NULL, ImGuiTreeNodeFlags_DefaultOpen))
+                {
+                    if (solver.integrator == ParticleLife::Integrator_Buffered && !solver.thread_busy_ms.empty())
+                    {
+                        float busiest = 0.0f, total = 0.0f;
+                        for (float ms : solver.thread_busy_ms)
+                        {
+                            busiest = ms > busiest ? ms : busiest;
+                            total += ms;
+                        }
+                        const float mean = total / solver.thread_busy_ms.size();
+                        ImGui::Text("Thread busy time (ms), max/mean %.2f", mean > 0.0f ? busiest / mean : 1.0f);
+                        ImGui::PlotHistogram("##busy", solver.thread_busy_ms.data(), static_cast<int>(solver.thread_busy_ms.size()), 0, NULL, 0.0f, busiest, ImVec2(0.0f, 80.0f));
+                    }
+                    else
+                    {
+                        ImGui::TextDisabled("Per-thread timings need the buffered integrator");
+                    }
+                    const ParticleLife::FrameArena& arena = ParticleLife::FrameArena::instance();
+                    ImGui::Text("Step heap allocations %d, scratch %d KB of %d KB", static_cast<int>(solver.heap_allocations),
+                        static_cast<int>(arena.high_water / 1024), static_cast<int>(arena.capacity() / 1024));
+                    ImGui::Text("Frame heap allocations %d, %d bytes; none for %d frames", static_cast<int>(last_frame.allocations),
+                        static_cast<int>(last_frame.bytes), clean_frames);
                 }
 
                 ImGui::End();
             }
-            // WHITE
-            if (WHITE_PARTICLES.size() > 0)
-            {
-                ParticleLife::rule(WHITE_PARTICLES, WHITE_PARTICLES, fwhite_white, white_radius);
-                ParticleLife::rule(WHITE_PARTICLES, BLUE_PARTICLES, fwhite_blue, white_radius);
-                ParticleLife::rule(WHITE_PARTICLES, RED_PARTICLES, fwhite_red, white_radius);
-                ParticleLife::rule(WHITE_PARTICLES, GREEN_PARTICLES, fwhite_green, white_radius);
-            }
-
-            // BLUE
-            if (BLUE_PARTICLES.size() > 0)
-            {
-                ParticleLife::rule(BLUE_PARTICLES, WHITE_PARTICLES, fblue_white, blue_radius);
-                ParticleLife::rule(BLUE_PARTICLES, BLUE_PARTICLES, fblue_blue, blue_radius);
-                ParticleLife::rule(BLUE_PARTICLES, RED_PARTICLES, fblue_red, blue_radius);
-                ParticleLife::rule(BLUE_PARTICLES, GREEN_PARTICLES, fblue_green, blue_radius);
-            }
-
-            // RED
-            if (RED_PARTICLES.size() > 0)
-            {
-                ParticleLife::rule(RED_PARTICLES, WHITE_PARTICLES, fred_white, red_radius);
-                ParticleLife::rule(RED_PARTICLES, BLUE_PARTICLES, fred_blue, red_radius);
-                ParticleLife::rule(RED_PARTICLES, RED_PARTICLES, fred_red, red_radius);
-                ParticleLife::rule(RED_PARTICLES, GREEN_PARTICLES, fred_green, red_radius);
-            }
-
-            // GREEN
-            if (GREEN_PARTICLES.size() > 0)
-            {
-                ParticleLife::rule(GREEN_PARTICLES, WHITE_PARTICLES, fgreen_white, green_radius);
-                ParticleLife::rule(GREEN_PARTICLES, BLUE_PARTICLES, fgreen_blue, green_radius);
-                ParticleLife::rule(GREEN_PARTICLES, RED_PARTICLES, fgreen_red, green_radius);
-                ParticleLife::rule(GREEN_PARTICLES, GREEN_PARTICLES, fgreen_green, green_radius);
-            }
+            const int steps = clock.advance(io.DeltaTime);
+            for (int s = steps; s > 0; --s)
+                solver.step(particle_groups, params);
 
             // move particles only after all forces have been recalculated
             // Commented out as this 'more accurate' way produces lses interesting patterns
@@ -273,20 +393,29 @@ int main(int, char**)
 
             {
                 ImGui::SetNextWindowPos(ImVec2(0.0f, 0.0f));
-                ImGui::SetNextWindowSize(ImVec2(WORLD_WIDTH, DISPLAY_HEIGHT));
-                ImGui::Begin("Canvas", NULL, ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoTitleBar);
+                ImGui::SetNextWindowSize(ImVec2(CANVAS_WIDTH, DISPLAY_HEIGHT));
+                ImGui::Begin("Canvas", NULL, ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoMove);
                 ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / io.Framerate, io.Framerate);
                 ImDrawList* draw_list = ImGui::GetWindowDrawList();
+                const ImVec2 canvas_pos = ImGui::GetWindowPos();
 
-                // iterating through groups and rendering each particle objectj
-                for (const auto& group : particle_groups)
+                // Drag to pan, scroll to zoom about the cursor.
+                if (ImGui::IsWindowHovered())
                 {
-                    for (const auto& p : group)
-                    {
-                        draw_list->AddCircleFilled(ImVec2(p.x, p.y), 1.8f, p.color);
-                    }
+                    if (ImGui::IsMouseDragging(ImGuiMouseButton_Left))
+                        camera.pan(io.MouseDelta.x, io.MouseDelta.y);
+                    if (io.MouseWheel != 0.0f)
+                        camera.zoomAt(io.MousePos.x - canvas_pos.x, io.MousePos.y - canvas_pos.y, powf(1.1f, io.MouseWheel));
                 }
 
+                // Culled through the solver's grid when it has one, else the renderer's own.
+                // Respawns and count changes come before the steps in the frame, so the
+                // solver's grid indexes the current groups only if a step ran since; on
+                // a frame without one it may be stale or not built at all.
+                const bool solver_grid = steps > 0 && solver.integrator == ParticleLife::Integrator_Buffered && solver.spatial == ParticleLife::Spatial_Grid &&
+                    (solver.storage == ParticleLife::Storage_Groups || solver.world.boundary == ParticleLife::Boundary_Periodic);
+                renderer.draw(draw_list, canvas_pos, ImVec2(CANVAS_WIDTH, DISPLAY_HEIGHT), camera, world, particle_groups, solver_grid ? &solver.grid : nullptr);
+
                 ImGui::End();
             }
         }